@@ -1,9 +1,12 @@
 #pragma once
 
 #include <SFML/Graphics.hpp>
+#include <memory>
 #include <unordered_map>
 #include <functional>
 
+#include "event_recorder.hpp"
+
 namespace sfev
 {
 
@@ -134,25 +137,120 @@ private:
 /*
     This class handles any type of event and call its associated callbacks if any.
     To process key event in a more convenient way its using a KeyManager
+
+    Events and the mouse position can be recorded to a file and replayed later, each call to processEvents
+    being a frame. The mouse position is sampled once per frame so that callbacks see the same position
+    when recording and replaying.
 */
 class EventManager
 {
 public:
     EventManager(sf::Window& window, bool use_builtin_helpers) :
-        m_window(window),
+        m_window(&window),
+        m_event_map(use_builtin_helpers)
+    {
+    }
+
+    // Without window, events can only come from a replay
+    explicit
+    EventManager(bool use_builtin_helpers) :
+        m_window(nullptr),
         m_event_map(use_builtin_helpers)
     {
     }
 
     // Calls events' attached callbacks
-    void processEvents(EventCallback fallback = nullptr) const
+    void processEvents(EventCallback fallback = nullptr)
     {
+        if (m_player) {
+            replayEvents(fallback);
+            return;
+        }
+
+        if (m_window) {
+            m_mouse_position = sf::Mouse::getPosition(*m_window);
+        }
+        if (m_recorder) {
+            m_recorder->setMousePosition(m_mouse_position);
+        }
+
         // Iterate over events
         sf::Event event;
-        while (m_window.pollEvent(event)) {
+        while (m_window && m_window->pollEvent(event)) {
+            if (m_recorder) {
+                m_recorder->addEvent(event);
+            }
             m_event_map.executeCallback(event, fallback);
         }
     }
+
+    // Records the events of the next frames to a file, returns false if it cannot be created
+    // The mouse positions are relative to a render area of size render_size, frames run steps of fixed_timestep
+    bool startRecording(const std::string& filename, sf::Vector2u render_size, float fixed_timestep)
+    {
+        m_recorder = std::make_unique<EventRecorder>(filename, render_size, fixed_timestep);
+        if (!m_recorder->isValid()) {
+            m_recorder = nullptr;
+            return false;
+        }
+        return true;
+    }
+
+    // Replaces live events by the ones of a recording, returns false if it cannot be read
+    bool startReplay(const std::string& filename)
+    {
+        m_player = std::make_unique<EventPlayer>(filename);
+        if (!m_player->isValid()) {
+            m_player = nullptr;
+            return false;
+        }
+        return true;
+    }
+
+    bool isReplaying() const
+    {
+        return m_player != nullptr;
+    }
+
+    bool isReplayFinished() const
+    {
+        return m_player && m_player->isFinished();
+    }
+
+    bool isReplayCorrupted() const
+    {
+        return m_player && m_player->isCorrupted();
+    }
+
+    // Size of the render area the replayed inputs were recorded with
+    sf::Vector2u getReplayRenderSize() const
+    {
+        return m_player ? m_player->getRenderSize() : sf::Vector2u{};
+    }
+
+    // Simulation step the replayed inputs were recorded with
+    float getReplayFixedTimestep() const
+    {
+        return m_player ? m_player->getFixedTimestep() : 0.0f;
+    }
+
+    // Index of the last replayed frame
+    uint32_t getReplayFrame() const
+    {
+        return m_player ? m_player->getFrame() : 0;
+    }
+
+    // Ends the frame, the frame time is saved when recording and replaced by the recorded one when replaying
+    float endFrame(float frame_time)
+    {
+        if (m_recorder) {
+            m_recorder->endFrame(frame_time);
+        }
+        if (m_player) {
+            return m_player->getFrameTime();
+        }
+        return frame_time;
+    }
     
     // Attaches new callback to an event
     void addEventCallback(sf::Event::EventType type, EventCallback callback)
@@ -192,18 +290,26 @@ public:
     
     sf::Window& getWindow()
     {
-        return m_window;
+        return *m_window;
     }
 
+    // Mouse position at the beginning of the frame
     sf::Vector2f getFloatMousePosition() const
     {
-        const sf::Vector2i mouse_position = sf::Mouse::getPosition(m_window);
-        return { static_cast<float>(mouse_position.x), static_cast<float>(mouse_position.y) };
+        return { static_cast<float>(m_mouse_position.x), static_cast<float>(m_mouse_position.y) };
     }
 
     sf::Vector2i getMousePosition() const
     {
-        return sf::Mouse::getPosition(m_window);
+        return m_mouse_position;
+    }
+
+    // Samples the mouse position again, for when the cursor has been moved by the application
+    void refreshMousePosition()
+    {
+        if (m_window && !m_player) {
+            m_mouse_position = sf::Mouse::getPosition(*m_window);
+        }
     }
 
     void bindBoolToKey(bool& boolean, sf::Keyboard::Key key)
@@ -219,8 +325,30 @@ public:
     }
 
 private:
-    sf::Window& m_window;
-    EventMap    m_event_map;
+    sf::Window*                    m_window;
+    EventMap                       m_event_map;
+    sf::Vector2i                   m_mouse_position;
+    std::unique_ptr<EventRecorder> m_recorder;
+    std::unique_ptr<EventPlayer>   m_player;
+
+    void replayEvents(EventCallback const& fallback)
+    {
+        // Live inputs are ignored, the window can still be closed
+        sf::Event event;
+        while (m_window && m_window->pollEvent(event)) {
+            if (event.type == sf::Event::Closed) {
+                m_event_map.executeCallback(event, fallback);
+            }
+        }
+
+        if (!m_player->nextFrame()) {
+            return;
+        }
+        m_mouse_position = m_player->getMousePosition();
+        for (const sf::Event& recorded_event : m_player->getEvents()) {
+            m_event_map.executeCallback(recorded_event, fallback);
+        }
+    }
 };
 
 } // End namespace
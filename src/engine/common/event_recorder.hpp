@@ -0,0 +1,221 @@
+#pragma once
+#include <cstring>
+#include <string>
+#include <vector>
+#include <SFML/Graphics.hpp>
+
+#include "binary_io.hpp"
+
+
+namespace sfev
+{
+
+/** Input file layout
+ *
+ *  A header holding the render size and the fixed timestep followed by records, each record starts with its type. Every frame ends with
+ *  a FrameEnd record holding the frame index and the frame time used by the application, so that replays also
+ *  reproduce the number of simulation steps of each frame, as long as the fixed timestep is the same.
+ *  Mouse positions are in pixels, they only map to the same world positions when replayed with the same render size.
+ */
+namespace input_file
+{
+    constexpr char     magic[4] = {'D', 'F', 'T', 'I'};
+    constexpr uint32_t version  = 3;
+
+    enum class Record : uint8_t
+    {
+        Event,
+        MousePosition,
+        FrameEnd
+    };
+}
+
+
+/// Writes the inputs of each frame to a file
+class EventRecorder
+{
+public:
+    EventRecorder(std::string const& filename, sf::Vector2u render_size, float fixed_timestep)
+        : m_writer{filename}
+    {
+        m_writer.outfile.write(input_file::magic, sizeof(input_file::magic));
+        m_writer.write(input_file::version);
+        m_writer.write(render_size);
+        m_writer.write(fixed_timestep);
+    }
+
+    [[nodiscard]]
+    bool isValid() const
+    {
+        return m_writer.outfile.operator bool();
+    }
+
+    void addEvent(sf::Event const& event)
+    {
+        m_writer.write(input_file::Record::Event);
+        m_writer.write(event);
+    }
+
+    /// Only written when the position changed since the last frame
+    void setMousePosition(sf::Vector2i position)
+    {
+        if (position == m_mouse_position) {
+            return;
+        }
+        m_mouse_position = position;
+        m_writer.write(input_file::Record::MousePosition);
+        m_writer.write(position);
+    }
+
+    void endFrame(float frame_time)
+    {
+        m_writer.write(input_file::Record::FrameEnd);
+        m_writer.write(m_frame);
+        m_writer.write(frame_time);
+        ++m_frame;
+    }
+
+private:
+    BinaryWriter m_writer;
+    uint32_t     m_frame          = 0;
+    sf::Vector2i m_mouse_position = {-1, -1};
+};
+
+
+/// Reads back the inputs written by an EventRecorder, one frame at a time
+class EventPlayer
+{
+public:
+    explicit
+    EventPlayer(std::string const& filename)
+        : m_reader{filename}
+    {
+        char magic[4] = {};
+        m_reader.infile.read(magic, sizeof(magic));
+        uint32_t const version = m_reader.read<uint32_t>();
+        m_render_size    = m_reader.read<sf::Vector2u>();
+        m_fixed_timestep = m_reader.read<float>();
+        m_valid = m_reader.isValid() &&
+                  std::memcmp(magic, input_file::magic, sizeof(magic)) == 0 &&
+                  version == input_file::version;
+    }
+
+    [[nodiscard]]
+    bool isValid() const
+    {
+        return m_valid;
+    }
+
+    /// True once all the recorded frames have been read, or when the file is corrupted
+    [[nodiscard]]
+    bool isFinished() const
+    {
+        return m_finished;
+    }
+
+    /// True if a frame was missing or out of order, the replay stops at the last valid frame
+    [[nodiscard]]
+    bool isCorrupted() const
+    {
+        return m_corrupted;
+    }
+
+    /// Size of the render area during the recording
+    [[nodiscard]]
+    sf::Vector2u getRenderSize() const
+    {
+        return m_render_size;
+    }
+
+    /// Duration of a simulation step during the recording
+    [[nodiscard]]
+    float getFixedTimestep() const
+    {
+        return m_fixed_timestep;
+    }
+
+    /** Reads the next frame
+     *
+     * @return false if there are no more frames
+     */
+    bool nextFrame()
+    {
+        m_events.clear();
+        while (m_valid && !m_finished) {
+            auto const record = m_reader.read<input_file::Record>();
+            if (!m_reader.isValid()) {
+                break;
+            }
+            switch (record) {
+                case input_file::Record::Event:
+                    m_events.push_back(m_reader.read<sf::Event>());
+                    break;
+                case input_file::Record::MousePosition:
+                    m_mouse_position = m_reader.read<sf::Vector2i>();
+                    break;
+                case input_file::Record::FrameEnd: {
+                    uint32_t const frame = m_reader.read<uint32_t>();
+                    m_frame_time         = m_reader.read<float>();
+                    if (!m_reader.isValid()) {
+                        break;
+                    }
+                    // Frames are written in order, anything else means that the file is damaged
+                    if (frame != m_next_frame) {
+                        m_corrupted = true;
+                        break;
+                    }
+                    m_frame = frame;
+                    ++m_next_frame;
+                    return true;
+                }
+                default:
+                    m_corrupted = true;
+                    break;
+            }
+            if (m_corrupted || !m_reader.isValid()) {
+                break;
+            }
+        }
+        m_finished = true;
+        return false;
+    }
+
+    [[nodiscard]]
+    std::vector<sf::Event> const& getEvents() const
+    {
+        return m_events;
+    }
+
+    [[nodiscard]]
+    sf::Vector2i getMousePosition() const
+    {
+        return m_mouse_position;
+    }
+
+    [[nodiscard]]
+    uint32_t getFrame() const
+    {
+        return m_frame;
+    }
+
+    [[nodiscard]]
+    float getFrameTime() const
+    {
+        return m_frame_time;
+    }
+
+private:
+    BinaryReader           m_reader;
+    bool                   m_valid          = false;
+    bool                   m_finished       = false;
+    bool                   m_corrupted      = false;
+    sf::Vector2u           m_render_size    = {};
+    float                  m_fixed_timestep = 0.0f;
+    uint32_t               m_next_frame     = 0;
+    std::vector<sf::Event> m_events;
+    sf::Vector2i           m_mouse_position = {};
+    uint32_t               m_frame          = 0;
+    float                  m_frame_time     = 0.0f;
+};
+
+}
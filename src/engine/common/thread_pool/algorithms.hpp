@@ -0,0 +1,169 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include "./thread_pool.hpp"
+
+
+/** Parallel algorithms giving the same results whatever the number of threads
+ *
+ *  The input is cut in blocks whose size only depends on the input size, blocks are processed in parallel and their
+ *  results are combined in block order. Floating point results can differ from a serial loop, but not between two
+ *  machines or two runs. Inputs fitting in a single block are processed on the calling thread, with the same result
+ *  as a serial loop.
+ */
+namespace tp
+{
+
+/// Inputs are cut in at most this many blocks, so that the partial results fit on the stack
+constexpr uint32_t max_blocks = 64;
+/// Smaller blocks would cost more to dispatch than to process
+constexpr uint32_t min_block_size = 1024;
+
+struct Blocks
+{
+    uint32_t size  = 0;
+    uint32_t count = 0;
+
+    explicit
+    Blocks(uint32_t element_count, uint32_t min_size = min_block_size)
+        : size{std::max(min_size, (element_count + max_blocks - 1) / max_blocks)}
+        , count{(element_count + size - 1) / size}
+    {}
+
+    [[nodiscard]]
+    uint32_t getBegin(uint32_t block) const
+    {
+        return block * size;
+    }
+
+    [[nodiscard]]
+    uint32_t getEnd(uint32_t block, uint32_t element_count) const
+    {
+        return std::min(element_count, (block + 1) * size);
+    }
+};
+
+/** Combines @p transform(i) for i in [0, count[ from left to right, starting from @p identity
+ *
+ * @param transform Returns the value of the element i
+ * @param combine Associative operation, combine(T, T) -> T
+ */
+template<typename T, typename TTransform, typename TCombine>
+T reduce(ThreadPool& pool, uint32_t count, T identity, TTransform&& transform, TCombine&& combine)
+{
+    Blocks const blocks{count};
+    auto const reduceBlock = [&](uint32_t block) {
+        T result = identity;
+        for (uint32_t i{blocks.getBegin(block)}, end{blocks.getEnd(block, count)}; i < end; ++i) {
+            result = combine(result, transform(i));
+        }
+        return result;
+    };
+    if (blocks.count <= 1) {
+        return reduceBlock(0);
+    }
+
+    std::array<T, max_blocks> partials;
+    pool.parallelFor(0, blocks.count, 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t block{begin}; block < end; ++block) {
+            partials[block] = reduceBlock(block);
+        }
+    });
+    T result = identity;
+    for (uint32_t block{0}; block < blocks.count; ++block) {
+        result = combine(result, partials[block]);
+    }
+    return result;
+}
+
+/** Writes in @p output[i] the combination of @p transform(j) for j in [0, i]
+ *
+ * @param transform Returns the value of the element i
+ * @param combine Associative operation, combine(T, T) -> T
+ * @param output At least @p count elements
+ */
+template<typename T, typename TTransform, typename TCombine>
+void inclusiveScan(ThreadPool& pool, uint32_t count, T identity, TTransform&& transform, TCombine&& combine, T* output)
+{
+    Blocks const blocks{count};
+    // Scan of each block starting from identity
+    auto const scanBlock = [&](uint32_t block) {
+        T sum = identity;
+        for (uint32_t i{blocks.getBegin(block)}, end{blocks.getEnd(block, count)}; i < end; ++i) {
+            sum = combine(sum, transform(i));
+            output[i] = sum;
+        }
+    };
+    if (blocks.count <= 1) {
+        if (count) {
+            scanBlock(0);
+        }
+        return;
+    }
+
+    pool.parallelFor(0, blocks.count, 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t block{begin}; block < end; ++block) {
+            scanBlock(block);
+        }
+    });
+    // Sum of the previous blocks, added to each block but the first one
+    std::array<T, max_blocks> offsets;
+    offsets[0] = identity;
+    for (uint32_t block{1}; block < blocks.count; ++block) {
+        offsets[block] = combine(offsets[block - 1], output[blocks.getEnd(block - 1, count) - 1]);
+    }
+    pool.parallelFor(1, blocks.count, 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t block{begin}; block < end; ++block) {
+            for (uint32_t i{blocks.getBegin(block)}, last{blocks.getEnd(block, count)}; i < last; ++i) {
+                output[i] = combine(offsets[block], output[i]);
+            }
+        }
+    });
+}
+
+/** Sorts @p data, blocks are sorted in parallel then merged two by two
+ *
+ * @param compare Strict weak ordering, equal elements keep the order they have after the blocks are sorted
+ * @param buffer Scratch memory, kept by the caller to avoid allocating at each call
+ */
+template<typename T, typename TCompare>
+void sort(ThreadPool& pool, std::vector<T>& data, TCompare&& compare, std::vector<T>& buffer)
+{
+    auto const   count = static_cast<uint32_t>(data.size());
+    Blocks const blocks{count};
+    if (blocks.count <= 1) {
+        std::sort(data.begin(), data.end(), compare);
+        return;
+    }
+
+    pool.parallelFor(0, blocks.count, 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t block{begin}; block < end; ++block) {
+            std::sort(data.begin() + blocks.getBegin(block), data.begin() + blocks.getEnd(block, count), compare);
+        }
+    });
+
+    buffer.resize(data.size());
+    std::vector<T>* source      = &data;
+    std::vector<T>* destination = &buffer;
+    for (uint32_t width{blocks.size}; width < count; width *= 2) {
+        uint32_t const merges_count = (count + 2 * width - 1) / (2 * width);
+        pool.parallelFor(0, merges_count, 1, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t merge{begin}; merge < end; ++merge) {
+                uint32_t const first  = merge * 2 * width;
+                uint32_t const middle = std::min(count, first + width);
+                uint32_t const last   = std::min(count, first + 2 * width);
+                std::merge(source->begin() + first, source->begin() + middle,
+                           source->begin() + middle, source->begin() + last,
+                           destination->begin() + first, compare);
+            }
+        });
+        std::swap(source, destination);
+    }
+    if (source != &data) {
+        data.swap(buffer);
+    }
+}
+
+}
@@ -0,0 +1,137 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <variant>
+
+#include "./latch.hpp"
+
+
+namespace tp
+{
+
+/** Lets a long running job know that its result is not needed anymore
+ *
+ *  Cancellation is cooperative: the job has to check @p isCancelled regularly and return early.
+ */
+class CancellationToken
+{
+public:
+    CancellationToken()
+        : m_cancelled{std::make_shared<std::atomic<bool>>(false)}
+    {}
+
+    void cancel()
+    {
+        m_cancelled->store(true, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]]
+    bool isCancelled() const
+    {
+        return m_cancelled->load(std::memory_order_relaxed);
+    }
+
+private:
+    std::shared_ptr<std::atomic<bool>> m_cancelled;
+};
+
+/// What a Future holds, jobs returning void only report that they completed
+template<typename T>
+using FutureValue = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+/// State shared by a job and its Future
+template<typename T>
+struct FutureState
+{
+    using Value = FutureValue<T>;
+
+    CancellationToken    token;
+    std::optional<Value> result;
+    std::atomic<bool> ready = false;
+    Latch             latch;
+
+    FutureState()
+    {
+        latch.add();
+    }
+
+    virtual ~FutureState() = default;
+
+    void setResult(Value&& value)
+    {
+        if (!token.isCancelled()) {
+            result.emplace(std::move(value));
+        }
+        ready.store(true, std::memory_order_release);
+        latch.done();
+    }
+};
+
+/** The result of a job submitted to the thread pool
+ *
+ *  Meant to be polled with @p isReady at a safe point of the frame, @p take then moves the result out.
+ *  Dropping a Future does not cancel its job, @p cancel has to be called explicitly.
+ *  For a job returning void, @p take returns an empty std::monostate if the job was not cancelled.
+ */
+template<typename T>
+class Future
+{
+public:
+    Future() = default;
+
+    explicit
+    Future(std::shared_ptr<FutureState<T>> state)
+        : m_state{std::move(state)}
+    {}
+
+    /// False if there is no job or its result has already been taken
+    [[nodiscard]]
+    bool isValid() const
+    {
+        return m_state != nullptr;
+    }
+
+    [[nodiscard]]
+    bool isReady() const
+    {
+        return m_state && m_state->ready.load(std::memory_order_acquire);
+    }
+
+    /// Asks the job to stop, its result will be discarded
+    void cancel()
+    {
+        if (m_state) {
+            m_state->token.cancel();
+        }
+    }
+
+    /// Blocks until the job is done
+    void wait()
+    {
+        if (m_state) {
+            m_state->latch.wait();
+        }
+    }
+
+    /** Waits for the job and moves its result out, the future is invalid afterward
+     *
+     * @return The result, or nothing if the job was cancelled
+     */
+    std::optional<FutureValue<T>> take()
+    {
+        if (!m_state) {
+            return std::nullopt;
+        }
+        wait();
+        std::optional<FutureValue<T>> result = std::move(m_state->result);
+        m_state = nullptr;
+        return result;
+    }
+
+private:
+    std::shared_ptr<FutureState<T>> m_state;
+};
+
+}
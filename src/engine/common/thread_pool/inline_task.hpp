@@ -0,0 +1,100 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+
+namespace tp
+{
+
+/** A callable stored in place instead of on the heap like std::function
+ *
+ *  Captures larger than @p capacity are rejected at compile time, capture by reference or pointer instead.
+ */
+class InlineTask
+{
+public:
+    static constexpr std::size_t capacity = 64;
+
+    InlineTask() = default;
+
+    template<typename TCallback, typename = std::enable_if_t<!std::is_same_v<std::decay_t<TCallback>, InlineTask>>>
+    InlineTask(TCallback&& callback)
+    {
+        using Callable = std::decay_t<TCallback>;
+        static_assert(sizeof(Callable) <= capacity, "Task captures are too large to be stored inline");
+        static_assert(alignof(Callable) <= alignof(std::max_align_t), "Task captures are over aligned");
+        new (m_storage) Callable(std::forward<TCallback>(callback));
+        m_operations = &operations<Callable>;
+    }
+
+    InlineTask(InlineTask&& other) noexcept
+    {
+        moveFrom(other);
+    }
+
+    InlineTask& operator=(InlineTask&& other) noexcept
+    {
+        if (this != &other) {
+            reset();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    InlineTask(InlineTask const&) = delete;
+    InlineTask& operator=(InlineTask const&) = delete;
+
+    ~InlineTask()
+    {
+        reset();
+    }
+
+    void operator()()
+    {
+        m_operations->invoke(m_storage);
+    }
+
+    explicit operator bool() const
+    {
+        return m_operations != nullptr;
+    }
+
+    void reset()
+    {
+        if (m_operations) {
+            m_operations->destroy(m_storage);
+            m_operations = nullptr;
+        }
+    }
+
+private:
+    struct Operations
+    {
+        void (*invoke)(void*);
+        void (*move)(void* destination, void* source);
+        void (*destroy)(void*);
+    };
+
+    template<typename T>
+    static constexpr Operations operations = {
+        [](void* callable) { (*static_cast<T*>(callable))(); },
+        [](void* destination, void* source) { new (destination) T(std::move(*static_cast<T*>(source))); },
+        [](void* callable) { static_cast<T*>(callable)->~T(); }
+    };
+
+    alignas(std::max_align_t) unsigned char m_storage[capacity];
+    Operations const* m_operations = nullptr;
+
+    void moveFrom(InlineTask& other)
+    {
+        if (other.m_operations) {
+            other.m_operations->move(m_storage, other.m_storage);
+            m_operations = other.m_operations;
+            other.reset();
+        }
+    }
+};
+
+}
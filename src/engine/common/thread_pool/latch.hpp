@@ -0,0 +1,63 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+
+namespace tp
+{
+
+/// Time spent checking for work before sleeping, waking up a sleeping thread costs a few microseconds
+constexpr std::chrono::microseconds spin_duration{50};
+
+/// Spins for at most @p spin_duration until @p predicate returns true, returns the last result of @p predicate
+template<typename TPredicate>
+bool spinUntil(TPredicate&& predicate)
+{
+    auto const start = std::chrono::steady_clock::now();
+    while (!predicate()) {
+        if (std::chrono::steady_clock::now() - start > spin_duration) {
+            return false;
+        }
+        std::this_thread::yield();
+    }
+    return true;
+}
+
+/// Counts pending work, @p wait returns once it reaches zero, spinning briefly before sleeping
+struct Latch
+{
+    std::atomic<uint32_t>   m_count = 0;
+    std::mutex              m_mutex;
+    std::condition_variable m_condition;
+
+    void add(uint32_t count = 1)
+    {
+        m_count += count;
+    }
+
+    void done()
+    {
+        // Under the lock, a waiter cannot miss the notification nor destroy the latch before it is sent
+        std::lock_guard<std::mutex> lock{m_mutex};
+        if (--m_count == 0) {
+            m_condition.notify_all();
+        }
+    }
+
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock{m_mutex, std::defer_lock};
+        if (spinUntil([this]() { return m_count == 0; })) {
+            // Waits for the last call to done to release the lock
+            lock.lock();
+            return;
+        }
+        lock.lock();
+        m_condition.wait(lock, [this]() { return m_count == 0; });
+    }
+};
+
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+
+namespace tp
+{
+
+/** Bounded lock-free queue between one producer thread and one consumer thread
+ *
+ *  Each side caches the last index it read from the other side, so the shared indices are only read when the queue
+ *  looks full or empty.
+ */
+template<typename T, uint32_t Capacity>
+class SPSCQueue
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    /// Producer only, returns false if the queue is full
+    bool push(T const& value)
+    {
+        uint32_t const tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head_cache == Capacity) {
+            m_head_cache = m_head.load(std::memory_order_acquire);
+            if (tail - m_head_cache == Capacity) {
+                return false;
+            }
+        }
+        m_items[tail & mask] = value;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Consumer only, returns false if the queue is empty
+    bool pop(T& value)
+    {
+        uint32_t const head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail_cache) {
+            m_tail_cache = m_tail.load(std::memory_order_acquire);
+            if (head == m_tail_cache) {
+                return false;
+            }
+        }
+        value = m_items[head & mask];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Consumer only, approximate if the producer is running
+    [[nodiscard]]
+    uint32_t getSize() const
+    {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_relaxed);
+    }
+
+    /// Consumer only, discards the items currently in the queue
+    void clear()
+    {
+        T value;
+        while (pop(value)) {}
+    }
+
+private:
+    static constexpr uint32_t mask = Capacity - 1;
+
+    // Indices only grow, wrapping around is handled by the unsigned arithmetic
+    alignas(64) std::atomic<uint32_t> m_head = 0;
+    uint32_t                          m_tail_cache = 0;
+    alignas(64) std::atomic<uint32_t> m_tail = 0;
+    uint32_t                          m_head_cache = 0;
+    alignas(64) std::array<T, Capacity> m_items = {};
+};
+
+}
@@ -0,0 +1,265 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "./thread_pool.hpp"
+
+
+namespace tp
+{
+
+/** Tasks with dependencies, built once and run as many times as needed
+ *
+ *  Each node counts its unfinished dependencies, the thread completing a node starts its ready successors: the first
+ *  one is executed right away as a continuation, the others are pushed as jobs on its deque for idle threads to steal.
+ *  They are not queued behind the tasks added with addTask, unless the deque is full or the thread has none (the graph
+ *  is run from a thread outside of the pool), in which case they fall back to the task queue.
+ *  Nodes without dependencies on each other run concurrently.
+ *  The duration of each node is kept from the last run to find the critical path.
+ */
+class TaskGraph
+{
+public:
+    using NodeID = uint32_t;
+
+    /// @p name is used by the profiler and the debug dump
+    template<typename TCallback>
+    NodeID addNode(std::string name, TCallback&& callback)
+    {
+        auto const id = static_cast<NodeID>(m_nodes.size());
+        Node& node = m_nodes.emplace_back();
+        node.name = std::move(name);
+        node.task = InlineTask{std::forward<TCallback>(callback)};
+        node.job.task = InlineTask{[this, id]() { execute(id); }};
+        node.job.done = true;
+#ifdef PEZ_PROFILING
+        node.zone = &pez::core::Profiler::get().createZone(node.name.c_str());
+#endif
+        return id;
+    }
+
+    /// @p after will only start once @p before is done
+    void addDependency(NodeID before, NodeID after)
+    {
+        m_nodes[before].successors.push_back(after);
+        ++m_nodes[after].dependencies;
+    }
+
+    /** Runs all the nodes and returns once they are all done
+     *
+     *  The calling thread executes nodes and other pending jobs until then, it only sleeps if it has no deque.
+     */
+    void run(ThreadPool& pool)
+    {
+        if (m_nodes.empty()) {
+            return;
+        }
+
+        m_pool      = &pool;
+        m_run_start = std::chrono::steady_clock::now();
+        m_remaining_nodes.add(static_cast<uint32_t>(m_nodes.size()));
+        // All counters have to be reset before a root starts and decrements them
+        for (Node& node : m_nodes) {
+            node.remaining_dependencies = node.dependencies;
+        }
+        NodeID first_root = no_node;
+        for (NodeID id{0}; id < m_nodes.size(); ++id) {
+            if (m_nodes[id].dependencies == 0) {
+                if (first_root == no_node) {
+                    first_root = id;
+                } else {
+                    spawn(id);
+                }
+            }
+        }
+        if (first_root != no_node) {
+            execute(first_root);
+        }
+        // Nodes started by other threads can still make successors ready, keep looking for them until the end
+        if (pool.hasThreadDeque()) {
+            while (m_remaining_nodes.m_count > 0) {
+                if (!pool.executeJob()) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+        m_remaining_nodes.wait();
+        // A job is marked done after its node, the thread executing it may still be about to write it
+        for (Node const& node : m_nodes) {
+            while (!node.job.done.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    [[nodiscard]]
+    std::string const& getName(NodeID id) const
+    {
+        return m_nodes[id].name;
+    }
+
+    /// Duration of the node during the last run, in milliseconds
+    [[nodiscard]]
+    float getDuration(NodeID id) const
+    {
+        return static_cast<float>(m_nodes[id].end_ns - m_nodes[id].start_ns) * 1e-6f;
+    }
+
+    /// The chain of dependent nodes with the longest total duration during the last run
+    [[nodiscard]]
+    std::vector<NodeID> getCriticalPath() const
+    {
+        auto const count = static_cast<NodeID>(m_nodes.size());
+        // Longest path ending at each node, nodes are processed in topological order
+        std::vector<float>    path_duration(count, 0.0f);
+        std::vector<NodeID>   previous(count, no_node);
+        std::vector<uint32_t> dependencies(count);
+        std::vector<NodeID>   ready;
+        for (NodeID id{0}; id < count; ++id) {
+            dependencies[id] = m_nodes[id].dependencies;
+            if (dependencies[id] == 0) {
+                ready.push_back(id);
+            }
+        }
+
+        NodeID last = no_node;
+        while (!ready.empty()) {
+            NodeID const id = ready.back();
+            ready.pop_back();
+            path_duration[id] += getDuration(id);
+            if (last == no_node || path_duration[id] > path_duration[last]) {
+                last = id;
+            }
+            for (NodeID const successor : m_nodes[id].successors) {
+                if (path_duration[id] > path_duration[successor]) {
+                    path_duration[successor] = path_duration[id];
+                    previous[successor]      = id;
+                }
+                if (--dependencies[successor] == 0) {
+                    ready.push_back(successor);
+                }
+            }
+        }
+
+        std::vector<NodeID> path;
+        for (NodeID id{last}; id != no_node; id = previous[id]) {
+            path.insert(path.begin(), id);
+        }
+        return path;
+    }
+
+    /// Writes the graph in the Graphviz format with the last durations, the critical path is highlighted
+    bool dump(std::string const& filename) const
+    {
+        std::ofstream file{filename};
+        if (!file) {
+            return false;
+        }
+
+        std::vector<bool> critical(m_nodes.size(), false);
+        for (NodeID const id : getCriticalPath()) {
+            critical[id] = true;
+        }
+
+        char duration[32];
+        file << "digraph TaskGraph {\n";
+        for (NodeID id{0}; id < m_nodes.size(); ++id) {
+            std::snprintf(duration, sizeof(duration), "%.3f ms", getDuration(id));
+            file << "    n" << id << " [label=\"" << m_nodes[id].name << "\\n" << duration << "\""
+                 << (critical[id] ? ", color=red" : "") << "];\n";
+        }
+        for (NodeID id{0}; id < m_nodes.size(); ++id) {
+            for (NodeID const successor : m_nodes[id].successors) {
+                file << "    n" << id << " -> n" << successor
+                     << (critical[id] && critical[successor] ? " [color=red]" : "") << ";\n";
+            }
+        }
+        file << "}\n";
+        return true;
+    }
+
+private:
+    static constexpr NodeID no_node = std::numeric_limits<NodeID>::max();
+
+    struct Node
+    {
+        std::string           name;
+        InlineTask            task;
+        /// Executes the node and its continuations, pushed when the node is not a continuation, done when not pushed
+        Job                   job{InlineTask{}};
+        std::vector<NodeID>   successors;
+        uint32_t              dependencies           = 0;
+        std::atomic<uint32_t> remaining_dependencies = 0;
+
+        /// Relative to the start of the last run
+        int64_t start_ns = 0;
+        int64_t end_ns   = 0;
+
+#ifdef PEZ_PROFILING
+        pez::core::Profiler::Zone* zone = nullptr;
+#endif
+    };
+
+    /// Nodes hold atomics, a deque keeps them in place
+    std::deque<Node> m_nodes;
+    Latch            m_remaining_nodes;
+    ThreadPool*      m_pool = nullptr;
+
+    std::chrono::steady_clock::time_point m_run_start;
+
+    /// Executes the node @p id and the chain of its continuations
+    void execute(NodeID id)
+    {
+        while (id != no_node) {
+            Node& node = m_nodes[id];
+            node.start_ns = getRunTime();
+            {
+#ifdef PEZ_PROFILING
+                pez::core::Profiler::Scope const scope{*node.zone};
+#endif
+                node.task();
+            }
+            node.end_ns = getRunTime();
+
+            NodeID continuation = no_node;
+            for (NodeID const successor : node.successors) {
+                if (--m_nodes[successor].remaining_dependencies == 0) {
+                    if (continuation == no_node) {
+                        continuation = successor;
+                    } else {
+                        spawn(successor);
+                    }
+                }
+            }
+            m_remaining_nodes.done();
+            id = continuation;
+        }
+    }
+
+    /// Lets another thread execute the node @p id, falls back to the task queue if the deque is full or missing
+    void spawn(NodeID id)
+    {
+        Job& job = m_nodes[id].job;
+        job.done.store(false, std::memory_order_relaxed);
+        if (!m_pool->pushJob(job)) {
+            job.done.store(true, std::memory_order_relaxed);
+            m_pool->addTask([this, id]() { execute(id); });
+        }
+    }
+
+    [[nodiscard]]
+    int64_t getRunTime() const
+    {
+        auto const elapsed = std::chrono::steady_clock::now() - m_run_start;
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    }
+};
+
+}
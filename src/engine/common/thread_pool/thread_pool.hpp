@@ -1,41 +1,193 @@
 #pragma once
-#include <functional>
-#include <queue>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <limits>
+#include <type_traits>
 #include <vector>
 #include <thread>
 #include <mutex>
 #include <atomic>
 
 #include "engine/engine.hpp"
+#include "./future.hpp"
+#include "./inline_task.hpp"
+#include "./latch.hpp"
+#include "./work_deque.hpp"
 
 
 namespace tp
 {
 
+/// Index of the work deque owned by the calling thread, set for the workers and the thread that created the pool
+struct ThreadDeque
+{
+    static constexpr uint32_t none = std::numeric_limits<uint32_t>::max();
+
+    static inline thread_local void const* pool  = nullptr;
+    static inline thread_local uint32_t    index = none;
+};
+
+/** Shared state of the workers
+ *
+ *  Tasks added with addTask go through a mutex guarded queue. Parallel loops split their range into jobs pushed on
+ *  the deque of the running thread, idle threads steal them.
+ */
 struct TaskQueue
 {
-    std::queue<std::function<void()>> m_tasks;
-    std::mutex                        m_mutex;
-    std::atomic<uint32_t>             m_remaining_tasks = 0;
+    struct Task
+    {
+        InlineTask                            callback;
+        std::chrono::steady_clock::time_point push_time;
+        /// False if the task is not waited for by waitForCompletion
+        bool                                  counted = true;
+    };
+
+    /// Ring buffer, only grows so that the steady state does not allocate
+    std::vector<Task>       m_tasks;
+    uint32_t                m_first_task = 0;
+    uint32_t                m_task_count = 0;
+    std::mutex              m_mutex;
+    std::condition_variable m_condition;
+    /// Mirrors the size of the queue to check for tasks without locking
+    std::atomic<uint32_t>   m_queued_tasks = 0;
+    std::atomic<uint32_t>   m_parked_workers = 0;
+    std::atomic<bool>       m_stopping       = false;
+    Latch                   m_remaining_tasks;
+
+    /// One per worker plus one for the thread that created the pool
+    std::vector<WorkDeque>  m_deques;
+
+    /// Time between tasks being added and started, to monitor the cost of waking up workers
+    std::atomic<uint64_t>   m_start_latency_ns = 0;
+    std::atomic<uint64_t>   m_started_tasks    = 0;
+
+    explicit
+    TaskQueue(uint32_t deque_count)
+        : m_tasks(16)
+        , m_deques(deque_count)
+    {}
 
     template<typename TCallback>
-    void addTask(TCallback&& callback)
+    void addTask(TCallback&& callback, bool counted = true)
     {
-        std::lock_guard<std::mutex> lock_guard{m_mutex};
-        m_tasks.push(std::forward<TCallback>(callback));
-        m_remaining_tasks++;
+        if (counted) {
+            m_remaining_tasks.add();
+        }
+        bool wake = false;
+        {
+            std::lock_guard<std::mutex> lock_guard{m_mutex};
+            if (m_task_count == m_tasks.size()) {
+                growTasks();
+            }
+            Task& task = m_tasks[(m_first_task + m_task_count) % m_tasks.size()];
+            task.callback  = std::forward<TCallback>(callback);
+            task.push_time = std::chrono::steady_clock::now();
+            task.counted   = counted;
+            ++m_task_count;
+            ++m_queued_tasks;
+            wake = m_parked_workers > 0;
+        }
+        if (wake) {
+            m_condition.notify_one();
+        }
     }
 
-    void getTask(std::function<void()>& target_callback)
+    /// Pops the oldest task, @p counted tells if workDone has to be called once it is executed
+    bool getTask(InlineTask& target_callback, bool& counted)
     {
+        if (m_queued_tasks == 0) {
+            return false;
+        }
+        std::chrono::steady_clock::time_point push_time;
         {
             std::lock_guard<std::mutex> lock_guard{m_mutex};
-            if (m_tasks.empty()) {
-                return;
+            if (m_task_count == 0) {
+                return false;
+            }
+            Task& task      = m_tasks[m_first_task];
+            target_callback = std::move(task.callback);
+            push_time       = task.push_time;
+            counted         = task.counted;
+            m_first_task    = (m_first_task + 1) % m_tasks.size();
+            --m_task_count;
+            --m_queued_tasks;
+        }
+        auto const latency = std::chrono::steady_clock::now() - push_time;
+        m_start_latency_ns += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count());
+        ++m_started_tasks;
+        return true;
+    }
+
+    /// Returns false if the deque is full, wakes up a parked worker to steal the job otherwise
+    bool pushJob(uint32_t deque, Job& job)
+    {
+        if (!m_deques[deque].push(&job)) {
+            return false;
+        }
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_parked_workers > 0) {
+            std::lock_guard<std::mutex> lock_guard{m_mutex};
+            m_condition.notify_one();
+        }
+        return true;
+    }
+
+    /// Pops from the deque @p deque first, then tries to steal from the others
+    Job* findJob(uint32_t deque)
+    {
+        auto const deque_count = static_cast<uint32_t>(m_deques.size());
+        if (Job* job = m_deques[deque].pop()) {
+            return job;
+        }
+        for (uint32_t i{1}; i < deque_count; ++i) {
+            if (Job* job = m_deques[(deque + i) % deque_count].steal()) {
+                return job;
             }
-            target_callback = std::move(m_tasks.front());
-            m_tasks.pop();
         }
+        return nullptr;
+    }
+
+    /// Executes other jobs until @p job is done, it can only still be in the deque @p deque if nobody stole it
+    void join(uint32_t deque, Job const& job)
+    {
+        while (!job.done.load(std::memory_order_acquire)) {
+            if (Job* other = findJob(deque)) {
+                other->execute();
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    [[nodiscard]]
+    bool hasWork() const
+    {
+        return m_queued_tasks > 0 || std::any_of(m_deques.begin(), m_deques.end(), [](WorkDeque const& deque) {
+            return !deque.isEmpty();
+        });
+    }
+
+    /// Returns when there is work or the queue is stopping, spinning briefly before sleeping
+    void waitForWork()
+    {
+        if (spinUntil([this]() { return hasWork(); })) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock{m_mutex};
+        ++m_parked_workers;
+        m_condition.wait(lock, [this]() { return hasWork() || m_stopping; });
+        --m_parked_workers;
+    }
+
+    /// Wakes up all the workers so that they can exit
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock_guard{m_mutex};
+            m_stopping = true;
+        }
+        m_condition.notify_all();
     }
 
     static void wait()
@@ -43,26 +195,35 @@ struct TaskQueue
         std::this_thread::yield();
     }
 
-    void waitForCompletion() const
+    void waitForCompletion()
     {
-        while (m_remaining_tasks > 0) {
-            wait();
-        }
+        m_remaining_tasks.wait();
     }
 
     void workDone()
     {
-        m_remaining_tasks--;
+        m_remaining_tasks.done();
+    }
+
+private:
+    void growTasks()
+    {
+        std::vector<Task> tasks(2 * m_tasks.size());
+        for (uint32_t i{0}; i < m_task_count; ++i) {
+            tasks[i] = std::move(m_tasks[(m_first_task + i) % m_tasks.size()]);
+        }
+        m_tasks      = std::move(tasks);
+        m_first_task = 0;
     }
 };
 
 struct Worker
 {
-    uint32_t              m_id      = 0;
-    std::thread           m_thread;
-    std::function<void()> m_task    = nullptr;
-    bool                  m_running = true;
-    TaskQueue*            m_queue   = nullptr;
+    uint32_t    m_id      = 0;
+    std::thread m_thread;
+    InlineTask  m_task;
+    bool        m_counted = true;
+    TaskQueue*  m_queue   = nullptr;
 
     Worker() = default;
 
@@ -77,21 +238,30 @@ struct Worker
 
     void run()
     {
-        while (m_running) {
-            m_queue->getTask(m_task);
-            if (m_task == nullptr) {
-                TaskQueue::wait();
-            } else {
+        PEZ_TRACE_THREAD("Worker " + std::to_string(m_id));
+        ThreadDeque::pool  = m_queue;
+        ThreadDeque::index = m_id;
+        while (!m_queue->m_stopping) {
+            if (Job* job = m_queue->findJob(m_id)) {
+                PEZ_PROFILE_SCOPE("tp::Job");
+                job->execute();
+            } else if (m_queue->getTask(m_task, m_counted)) {
+                PEZ_PROFILE_SCOPE("tp::Task");
                 m_task();
-                m_queue->workDone();
-                m_task = nullptr;
+                m_task.reset();
+                if (m_counted) {
+                    m_queue->workDone();
+                }
+            } else {
+                m_queue->waitForWork();
             }
         }
     }
 
+    /// Stops all the workers sharing the queue and waits for this one to exit
     void stop()
     {
-        m_running = false;
+        m_queue->stop();
         m_thread.join();
     }
 };
@@ -105,7 +275,12 @@ struct ThreadPool
     explicit
     ThreadPool(uint32_t thread_count)
         : m_thread_count{thread_count}
+        , m_queue{thread_count + 1}
     {
+        // The last deque belongs to the creating thread so that it can split loops too
+        ThreadDeque::pool  = &m_queue;
+        ThreadDeque::index = thread_count;
+
         m_workers.reserve(thread_count);
         for (uint32_t i{thread_count}; i--;) {
             m_workers.emplace_back(m_queue, static_cast<uint32_t>(m_workers.size()));
@@ -117,35 +292,133 @@ struct ThreadPool
         for (Worker& worker : m_workers) {
             worker.stop();
         }
+        if (ThreadDeque::pool == &m_queue) {
+            ThreadDeque::pool = nullptr;
+        }
     }
 
+    /// Adds a task executed by one of the workers, its captures have to fit in an InlineTask
     template<typename TCallback>
     void addTask(TCallback&& callback)
     {
         m_queue.addTask(std::forward<TCallback>(callback));
     }
 
-    void waitForCompletion() const
+    /** Runs @p callback(CancellationToken const&) on a worker and returns the Future of its result
+     *
+     *  Meant for long computations that should not block the frame. The callback is stored next to the result, so
+     *  unlike with addTask its captures are not limited in size. Submitted jobs are not waited for by
+     *  @p waitForCompletion, use the returned Future instead.
+     */
+    template<typename TCallback>
+    auto submit(TCallback&& callback)
+    {
+        using Callback = std::decay_t<TCallback>;
+        using Result   = std::invoke_result_t<Callback&, CancellationToken const&>;
+
+        struct AsyncJob : public FutureState<Result>
+        {
+            Callback callback;
+
+            explicit
+            AsyncJob(TCallback&& callback_)
+                : callback{std::forward<TCallback>(callback_)}
+            {}
+        };
+
+        auto job = std::make_shared<AsyncJob>(std::forward<TCallback>(callback));
+        m_queue.addTask([job]() {
+            if constexpr (std::is_void_v<Result>) {
+                job->callback(job->token);
+                job->setResult({});
+            } else {
+                job->setResult(job->callback(job->token));
+            }
+        }, false);
+        return Future<Result>{job};
+    }
+
+    /// Pushes @p job on the deque of the calling thread for any thread to take, false if it has none or if it is full
+    bool pushJob(Job& job)
+    {
+        uint32_t const deque = getThreadDeque();
+        return deque != ThreadDeque::none && m_queue.pushJob(deque, job);
+    }
+
+    /// True for the workers and the thread that created the pool
+    [[nodiscard]]
+    bool hasThreadDeque() const
+    {
+        return getThreadDeque() != ThreadDeque::none;
+    }
+
+    /// Executes one of the pending jobs, returns false if there was none or if the calling thread has no deque
+    bool executeJob()
+    {
+        uint32_t const deque = getThreadDeque();
+        if (deque == ThreadDeque::none) {
+            return false;
+        }
+        if (Job* job = m_queue.findJob(deque)) {
+            job->execute();
+            return true;
+        }
+        return false;
+    }
+
+    /// Waits for the tasks added with addTask, parallel loops return once done and submitted jobs are not waited for
+    void waitForCompletion()
     {
         m_queue.waitForCompletion();
     }
 
+    /// Mean time in microseconds between a task being added and a worker starting it, since the last call
+    float getStartLatency()
+    {
+        uint64_t const count = m_queue.m_started_tasks.exchange(0);
+        uint64_t const sum   = m_queue.m_start_latency_ns.exchange(0);
+        return count ? static_cast<float>(sum) / static_cast<float>(count) * 1e-3f : 0.0f;
+    }
+
+    /** Calls @p callback(start, end) on sub ranges of [begin, end[ of at most @p grain elements, in parallel
+     *
+     *  The range is split in halves recursively, the second half being left for other threads to steal while the
+     *  first one is processed. Nothing is allocated, jobs live on the stack of the thread splitting the range.
+     *  Can be called from tasks, a thread without a deque hands the whole loop over to a worker, or runs it
+     *  itself if the pool has no worker.
+     */
     template<typename TCallback>
-    void dispatch(uint32_t element_count, TCallback&& callback)
+    void parallelFor(uint32_t begin, uint32_t end, uint32_t grain, TCallback&& callback)
     {
-        const uint32_t batch_size = element_count / m_thread_count;
-        for (uint32_t i{0}; i < m_thread_count; ++i) {
-            const uint32_t start = batch_size * i;
-            const uint32_t end   = start + batch_size;
-            addTask([start, end, &callback](){ callback(start, end); });
+        if (begin >= end) {
+            return;
         }
-
-        if (batch_size * m_thread_count < element_count) {
-            const uint32_t start = batch_size * m_thread_count;
-            callback(start, element_count);
+        grain = std::max(grain, 1u);
+        uint32_t const deque = getThreadDeque();
+        if (deque == ThreadDeque::none) {
+            // Nobody would ever run the task
+            if (m_thread_count == 0) {
+                callback(begin, end);
+                return;
+            }
+            Latch latch;
+            latch.add();
+            addTask([this, begin, end, grain, &callback, &latch]() {
+                split(getThreadDeque(), begin, end, grain, callback);
+                latch.done();
+            });
+            latch.wait();
+            return;
         }
+        split(deque, begin, end, grain, callback);
+    }
 
-        waitForCompletion();
+    /// Splits [0, element_count[ in a few ranges per thread so that the load can be balanced
+    template<typename TCallback>
+    void dispatch(uint32_t element_count, TCallback&& callback)
+    {
+        uint32_t const grain = element_count / (4 * (m_thread_count + 1));
+        parallelFor(0, element_count, grain, callback);
     }
 
     template<typename TContainer, typename TCallback>
@@ -157,6 +430,30 @@ struct ThreadPool
             }
         });
     }
+
+private:
+    [[nodiscard]]
+    uint32_t getThreadDeque() const
+    {
+        return ThreadDeque::pool == &m_queue ? ThreadDeque::index : ThreadDeque::none;
+    }
+
+    template<typename TCallback>
+    void split(uint32_t deque, uint32_t begin, uint32_t end, uint32_t grain, TCallback& callback)
+    {
+        if (end - begin > grain) {
+            uint32_t const middle = begin + (end - begin) / 2;
+            Job job{[this, middle, end, grain, &callback]() {
+                split(getThreadDeque(), middle, end, grain, callback);
+            }};
+            if (m_queue.pushJob(deque, job)) {
+                split(deque, begin, middle, grain, callback);
+                m_queue.join(deque, job);
+                return;
+            }
+        }
+        callback(begin, end);
+    }
 };
 
 }
@@ -0,0 +1,108 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "./inline_task.hpp"
+
+
+namespace tp
+{
+
+/// A piece of a parallel loop, it lives on the stack of the thread that created it until @p done is set
+struct Job
+{
+    InlineTask        task;
+    std::atomic<bool> done = false;
+
+    explicit
+    Job(InlineTask&& task_)
+        : task{std::move(task_)}
+    {}
+
+    void execute()
+    {
+        task();
+        done.store(true, std::memory_order_release);
+    }
+};
+
+/** Chase-Lev work stealing deque with a fixed capacity
+ *
+ *  The owner thread pushes and pops at the bottom, other threads steal from the top. Recursive splitting only
+ *  keeps a logarithmic number of jobs per thread, a full deque makes the owner run the work itself.
+ *  See "Correct and Efficient Work-Stealing for Weak Memory Models", Lê et al. 2013.
+ */
+class WorkDeque
+{
+public:
+    static constexpr int64_t capacity = 256;
+
+    /// Owner only, returns false if the deque is full
+    bool push(Job* job)
+    {
+        int64_t const bottom = m_bottom.load(std::memory_order_relaxed);
+        int64_t const top    = m_top.load(std::memory_order_acquire);
+        if (bottom - top >= capacity) {
+            return false;
+        }
+        m_jobs[bottom % capacity].store(job, std::memory_order_relaxed);
+        // Publishes the job to the thieves
+        m_bottom.store(bottom + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Owner only, returns the most recently pushed job or nullptr
+    Job* pop()
+    {
+        int64_t const bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+        m_bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = m_top.load(std::memory_order_relaxed);
+        if (top > bottom) {
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        Job* job = m_jobs[bottom % capacity].load(std::memory_order_relaxed);
+        if (top == bottom) {
+            // Last job, thieves may be racing for it
+            if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                job = nullptr;
+            }
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return job;
+    }
+
+    /// Any thread, returns the oldest job or nullptr if the deque is empty or another thread won the race
+    Job* steal()
+    {
+        int64_t top = m_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t const bottom = m_bottom.load(std::memory_order_acquire);
+        if (top >= bottom) {
+            return nullptr;
+        }
+
+        Job* const job = m_jobs[top % capacity].load(std::memory_order_relaxed);
+        if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return job;
+    }
+
+    [[nodiscard]]
+    bool isEmpty() const
+    {
+        return m_top.load(std::memory_order_seq_cst) >= m_bottom.load(std::memory_order_seq_cst);
+    }
+
+private:
+    // Thieves and owner update different ends, keep them on different cache lines
+    alignas(64) std::atomic<int64_t> m_top    = 0;
+    alignas(64) std::atomic<int64_t> m_bottom = 0;
+    std::array<std::atomic<Job*>, capacity> m_jobs = {};
+};
+
+}
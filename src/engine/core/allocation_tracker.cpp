@@ -0,0 +1,181 @@
+#include "./allocation_tracker.hpp"
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+
+namespace
+{
+/// Trivial types only, operator new can be called before or after the thread's dynamic initialization
+thread_local pez::core::AllocationTracker::Counters thread_counters;
+
+std::atomic<uint64_t> frame_count = 0;
+std::atomic<uint64_t> frame_bytes = 0;
+
+pez::core::AllocationTracker::Counters last_frame;
+}
+
+pez::core::AllocationTracker::Counters pez::core::AllocationTracker::getThreadCounters()
+{
+    return thread_counters;
+}
+
+pez::core::AllocationTracker::Counters pez::core::AllocationTracker::getLastFrame()
+{
+    return last_frame;
+}
+
+void pez::core::AllocationTracker::endFrame()
+{
+    last_frame.count = frame_count.exchange(0, std::memory_order_relaxed);
+    last_frame.bytes = frame_bytes.exchange(0, std::memory_order_relaxed);
+}
+
+void pez::core::AllocationTracker::record(uint64_t bytes)
+{
+    ++thread_counters.count;
+    thread_counters.bytes += bytes;
+    frame_count.fetch_add(1, std::memory_order_relaxed);
+    frame_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+#ifdef PEZ_TRACK_ALLOCATIONS
+
+namespace
+{
+void* allocate(std::size_t size)
+{
+    pez::core::AllocationTracker::record(size);
+    return std::malloc(size ? size : 1);
+}
+
+/// The address returned by malloc is stored right before the aligned block
+void* allocateAligned(std::size_t size, std::align_val_t alignment)
+{
+    auto const align = static_cast<std::size_t>(alignment);
+    pez::core::AllocationTracker::record(size);
+    void* const raw = std::malloc(size + align + sizeof(void*));
+    if (!raw) {
+        return nullptr;
+    }
+    auto const address = (reinterpret_cast<std::uintptr_t>(raw) + sizeof(void*) + align - 1) & ~(align - 1);
+    reinterpret_cast<void**>(address)[-1] = raw;
+    return reinterpret_cast<void*>(address);
+}
+
+void freeAligned(void* ptr)
+{
+    if (ptr) {
+        std::free(static_cast<void**>(ptr)[-1]);
+    }
+}
+}
+
+void* operator new(std::size_t size)
+{
+    if (void* const ptr = allocate(size)) {
+        return ptr;
+    }
+    throw std::bad_alloc{};
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, std::nothrow_t const&) noexcept
+{
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size, std::nothrow_t const&) noexcept
+{
+    return allocate(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    if (void* const ptr = allocateAligned(size, alignment)) {
+        return ptr;
+    }
+    throw std::bad_alloc{};
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return operator new(size, alignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, std::nothrow_t const&) noexcept
+{
+    return allocateAligned(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, std::nothrow_t const&) noexcept
+{
+    return allocateAligned(size, alignment);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::nothrow_t const&) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::nothrow_t const&) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+    freeAligned(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept
+{
+    freeAligned(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept
+{
+    freeAligned(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept
+{
+    freeAligned(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t, std::nothrow_t const&) noexcept
+{
+    freeAligned(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t, std::nothrow_t const&) noexcept
+{
+    freeAligned(ptr);
+}
+
+#endif
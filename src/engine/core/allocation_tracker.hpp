@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+
+
+namespace pez::core
+{
+
+/** Counts heap allocations to find and keep them out of hot paths
+ *
+ *  Only active when built with PEZ_TRACK_ALLOCATIONS, the global operator new is then replaced to count the
+ *  allocations of each thread and of the current frame. Profiler zones also record the allocations made while they
+ *  are entered. Without it, all counters stay at zero.
+ */
+class AllocationTracker
+{
+public:
+#ifdef PEZ_TRACK_ALLOCATIONS
+    static constexpr bool enabled = true;
+#else
+    static constexpr bool enabled = false;
+#endif
+
+    struct Counters
+    {
+        uint64_t count = 0;
+        uint64_t bytes = 0;
+    };
+
+    /// Allocations made by the calling thread since it started
+    static Counters getThreadCounters();
+
+    /// Allocations made by all threads during the last completed frame
+    static Counters getLastFrame();
+
+    /// Closes the current frame, called at the end of pez::core::render
+    static void endFrame();
+
+    /// Called by the replaced operator new
+    static void record(uint64_t bytes);
+};
+
+}
@@ -2,6 +2,8 @@
 
 #include <iostream>
 
+#include "profiler.hpp"
+#include "trace_recorder.hpp"
 #include "system.hpp"
 #include "entity.hpp"
 #include "entity_container.hpp"
@@ -76,6 +78,9 @@ struct EntityManager
         static_assert(std::is_convertible<T*, IRenderer*>::value, "Provided class is not a Renderer");
         System<T>::create(std::forward<Arg>(args)...);
         render_callbacks.push_back(Renderer<T>::render);
+        if constexpr (std::is_convertible<T*, IProcessor*>::value) {
+            update_callbacks.push_back(Processor<T>::update);
+        }
         on_stop_callbacks.push_back(System<T>::stop);
         clear_systems.push_back(System<T>::clear);
     }
@@ -112,6 +117,7 @@ struct EntityManager
 
     void render(pez::render::Context& context)
     {
+        PEZ_PROFILE_SCOPE("EntityManager::render");
         for (const RenderCallback& f : render_callbacks) {
             f(context);
         }
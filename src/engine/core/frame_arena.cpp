@@ -0,0 +1,75 @@
+#include "./frame_arena.hpp"
+#include <algorithm>
+
+
+std::atomic<uint64_t> pez::core::FrameArena::s_frame = 0;
+
+pez::core::FrameArena::FrameArena(size_t block_size)
+    : m_block_size{block_size}
+{}
+
+void* pez::core::FrameArena::allocate(size_t size, size_t alignment)
+{
+    if (m_blocks.empty()) {
+        addBlock(size + alignment);
+    }
+    while (true) {
+        Block const&    block = m_blocks[m_block];
+        auto const      base  = reinterpret_cast<uintptr_t>(block.data.get());
+        uintptr_t const begin = ((base + m_offset + alignment - 1) & ~(alignment - 1)) - base;
+        if (begin + size <= block.size) {
+            m_offset = begin + size;
+            m_used  += size;
+            m_peak   = std::max(m_peak, m_used);
+            return block.data.get() + begin;
+        }
+        // Only happens until the frame's needs are known, blocks are merged at the next reset
+        addBlock(size + alignment);
+    }
+}
+
+void pez::core::FrameArena::reset()
+{
+    if (m_blocks.size() > 1) {
+        size_t const capacity = getCapacity();
+        m_blocks.clear();
+        addBlock(capacity);
+    }
+    m_block  = 0;
+    m_offset = 0;
+    m_used   = 0;
+}
+
+size_t pez::core::FrameArena::getCapacity() const
+{
+    size_t capacity = 0;
+    for (Block const& block : m_blocks) {
+        capacity += block.size;
+    }
+    return capacity;
+}
+
+void pez::core::FrameArena::addBlock(size_t min_size)
+{
+    // Growing geometrically keeps the number of blocks low when a frame needs much more than usual
+    size_t const size = std::max({m_block_size, min_size, getCapacity()});
+    m_blocks.push_back({std::make_unique<std::byte[]>(size), size});
+    m_block  = m_blocks.size() - 1;
+    m_offset = 0;
+}
+
+pez::core::FrameArena& pez::core::FrameArena::get()
+{
+    thread_local FrameArena arena;
+    uint64_t const frame = s_frame.load(std::memory_order_relaxed);
+    if (arena.m_frame != frame) {
+        arena.reset();
+        arena.m_frame = frame;
+    }
+    return arena;
+}
+
+void pez::core::FrameArena::endFrame()
+{
+    s_frame.fetch_add(1, std::memory_order_relaxed);
+}
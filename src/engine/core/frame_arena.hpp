@@ -0,0 +1,165 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+
+namespace pez::core
+{
+
+/** Linear allocator for data that does not outlive the frame
+ *
+ *  Allocating only moves an offset forward, memory is never freed individually but all at once when the frame ends.
+ *  Each thread has its own arena, see @p get, so workers can allocate without synchronization. When a frame needs
+ *  more than one block, the blocks are merged at the next reset so that the steady state uses a single block.
+ */
+class FrameArena
+{
+public:
+    static constexpr size_t default_block_size = 256 * 1024;
+
+    explicit
+    FrameArena(size_t block_size = default_block_size);
+
+    FrameArena(FrameArena const&) = delete;
+    FrameArena& operator=(FrameArena const&) = delete;
+
+    /// Returns @p size bytes aligned on @p alignment, valid until the next reset
+    void* allocate(size_t size, size_t alignment);
+
+    /// Makes all the memory available again
+    void reset();
+
+    /// Bytes allocated since the last reset
+    [[nodiscard]]
+    size_t getUsed() const
+    {
+        return m_used;
+    }
+
+    /// Maximum number of bytes allocated in a frame
+    [[nodiscard]]
+    size_t getPeak() const
+    {
+        return m_peak;
+    }
+
+    [[nodiscard]]
+    size_t getCapacity() const;
+
+    /** The arena of the calling thread
+     *
+     *  It is reset the first time it is used in a frame, so that workers never touch another thread's arena.
+     *  Jobs spanning multiple frames must not keep memory from it.
+     */
+    static FrameArena& get();
+
+    /// Releases the memory allocated during the frame by all threads, called at the end of pez::core::render
+    static void endFrame();
+
+private:
+    struct Block
+    {
+        std::unique_ptr<std::byte[]> data;
+        size_t                       size = 0;
+    };
+
+    std::vector<Block> m_blocks;
+    size_t             m_block_size;
+    /// Current block and offset in it
+    size_t             m_block  = 0;
+    size_t             m_offset = 0;
+    size_t             m_used   = 0;
+    size_t             m_peak   = 0;
+    /// Frame of the last reset
+    uint64_t           m_frame  = 0;
+
+    static std::atomic<uint64_t> s_frame;
+
+    void addBlock(size_t min_size);
+};
+
+/// STL allocator drawing from a FrameArena, deallocation is a no-op
+template<typename T>
+class FrameAllocator
+{
+public:
+    using value_type = T;
+
+    /// Uses the arena of the calling thread
+    FrameAllocator()
+        : m_arena{&FrameArena::get()}
+    {}
+
+    explicit
+    FrameAllocator(FrameArena& arena)
+        : m_arena{&arena}
+    {}
+
+    template<typename U>
+    FrameAllocator(FrameAllocator<U> const& other)
+        : m_arena{other.getArena()}
+    {}
+
+    [[nodiscard]]
+    T* allocate(size_t count)
+    {
+        return static_cast<T*>(m_arena->allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T*, size_t) {}
+
+    [[nodiscard]]
+    FrameArena* getArena() const
+    {
+        return m_arena;
+    }
+
+    template<typename U>
+    bool operator==(FrameAllocator<U> const& other) const
+    {
+        return m_arena == other.getArena();
+    }
+
+    template<typename U>
+    bool operator!=(FrameAllocator<U> const& other) const
+    {
+        return m_arena != other.getArena();
+    }
+
+private:
+    FrameArena* m_arena;
+};
+
+template<typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+using FrameString = std::basic_string<char, std::char_traits<char>, FrameAllocator<char>>;
+
+/** Formats @p value like toString, in the arena of the calling thread
+ *
+ * @return A view valid until the end of the frame
+ */
+template<typename T>
+std::string_view toFrameString(T const& value, uint8_t decimals = 2)
+{
+    auto const format = [&](char* buffer, size_t size) {
+        if constexpr (std::is_integral_v<T>) {
+            return std::snprintf(buffer, size, "%lld", static_cast<long long>(value));
+        } else {
+            return std::snprintf(buffer, size, "%.*f", static_cast<int>(decimals), static_cast<double>(value));
+        }
+    };
+    auto const length = static_cast<size_t>(format(nullptr, 0));
+    auto const buffer = static_cast<char*>(FrameArena::get().allocate(length + 1, 1));
+    format(buffer, length + 1);
+    return {buffer, length};
+}
+
+}
@@ -1,4 +1,5 @@
 #include "instance.hpp"
+#include <algorithm>
 
 namespace pez::core
 {
@@ -27,6 +28,7 @@ void EngineInstance::render()
 void EngineInstance::update(float dt)
 {
     if (pause) { return; }
+    PEZ_PROFILE_SCOPE("EngineInstance::update");
     // Update all entities
     m_entity_manager.updateEntities(dt);
     // Remove entities that requested removal
@@ -36,6 +38,25 @@ void EngineInstance::update(float dt)
     tick++;
 }
 
+void EngineInstance::updateFixed(float frame_dt)
+{
+    if (pause) {
+        accumulator = 0.0f;
+        return;
+    }
+
+    accumulator += frame_dt;
+    uint32_t steps = 0;
+    while (accumulator >= fixed_dt && steps < max_steps_per_frame) {
+        update(fixed_dt);
+        accumulator -= fixed_dt;
+        ++steps;
+    }
+    // Under load, the time that could not be simulated is dropped to avoid accumulating a growing delay
+    accumulator   = std::min(accumulator, fixed_dt);
+    interpolation = accumulator / fixed_dt;
+}
+
 std::unique_ptr<pez::core::EngineInstance> pez::core::GlobalInstance::instance = nullptr;
 
 }
@@ -21,9 +21,17 @@ struct EngineInstance
     uint64_t tick  = 0;
     bool     pause = false;
 
+    // Fixed timestep attributes
+    float    fixed_dt            = 1.0f / 60.0f;
+    float    accumulator         = 0.0f;
+    float    interpolation       = 0.0f;
+    /// Maximum number of steps per frame, beyond that the simulation slows down instead of trying to catch up
+    uint32_t max_steps_per_frame = 4;
+
     EngineInstance();
 
     void update(float dt);
+    void updateFixed(float frame_dt);
     void quit();
     void render();
 };
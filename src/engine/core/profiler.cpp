@@ -0,0 +1,63 @@
+#include "./profiler.hpp"
+#include "./trace_recorder.hpp"
+
+
+namespace
+{
+/// The innermost zone entered on this thread
+thread_local pez::core::Profiler::Zone* current_zone = nullptr;
+}
+
+pez::core::Profiler::Scope::Scope(Zone& zone)
+    : m_zone{zone}
+    , m_parent{current_zone}
+    , m_start{std::chrono::steady_clock::now()}
+    , m_allocations{AllocationTracker::getThreadCounters().count}
+{
+    current_zone = &m_zone;
+    TraceRecorder::get().record(m_zone.name.c_str(), TraceRecorder::Phase::Begin);
+}
+
+pez::core::Profiler::Scope::~Scope()
+{
+    auto const elapsed = std::chrono::steady_clock::now() - m_start;
+    TraceRecorder::get().record(m_zone.name.c_str(), TraceRecorder::Phase::End);
+    m_zone.frame_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    ++m_zone.frame_calls;
+    m_zone.frame_allocations += AllocationTracker::getThreadCounters().count - m_allocations;
+    current_zone = m_parent;
+}
+
+pez::core::Profiler& pez::core::Profiler::get()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+pez::core::Profiler::Zone& pez::core::Profiler::createZone(char const* name)
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    Zone& zone  = m_zones.emplace_back();
+    zone.name   = name;
+    zone.parent = current_zone;
+    zone.depth  = current_zone ? current_zone->depth + 1 : 0;
+    return zone;
+}
+
+void pez::core::Profiler::endFrame()
+{
+    auto const now = std::chrono::steady_clock::now();
+    float const frame_time = std::chrono::duration<float, std::milli>(now - m_frame_start).count();
+    m_frame_start = now;
+    m_frame_time.addValue(frame_time);
+    m_frame_history.addValueBase(frame_time);
+
+    std::lock_guard<std::mutex> lock{m_mutex};
+    for (Zone& zone : m_zones) {
+        zone.last  = static_cast<float>(zone.frame_ns.exchange(0)) * 1e-6f;
+        zone.calls = zone.frame_calls.exchange(0);
+        zone.allocations = zone.frame_allocations.exchange(0);
+        zone.mean.addValue(zone.last);
+        zone.history.addValueBase(zone.last);
+    }
+}
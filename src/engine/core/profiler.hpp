@@ -0,0 +1,137 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+
+#include "engine/common/racc.hpp"
+#include "./allocation_tracker.hpp"
+
+
+namespace pez::core
+{
+
+/** Accumulates the time spent in named code zones, frame by frame
+ *
+ *  Zones are declared with PEZ_PROFILE_SCOPE and can be entered from any thread. The parent of a zone is the zone
+ *  enclosing it the first time it is entered on its thread, zones first entered outside of any other zone are roots.
+ *  At the end of each frame, the time accumulated by each zone is pushed into its rolling stats.
+ *  Each entry and exit is also recorded by the TraceRecorder.
+ */
+class Profiler
+{
+public:
+    /// Number of frames used to compute the mean durations
+    static constexpr uint32_t mean_frames_count    = 60;
+    /// Number of frames kept in the history of each zone
+    static constexpr uint32_t history_frames_count = 120;
+
+    struct Zone
+    {
+        std::string name;
+        Zone const* parent = nullptr;
+        uint32_t    depth  = 0;
+
+        /// Time, calls and allocations of the current frame
+        std::atomic<int64_t>  frame_ns          = 0;
+        std::atomic<uint32_t> frame_calls       = 0;
+        std::atomic<uint64_t> frame_allocations = 0;
+
+        /// Stats of the completed frames, in milliseconds
+        RMean<float>    mean{mean_frames_count};
+        RAccBase<float> history{history_frames_count};
+        float           last  = 0.0f;
+        uint32_t        calls = 0;
+        /// Allocations of the last frame, including the ones of nested zones, see AllocationTracker
+        uint64_t        allocations = 0;
+
+        [[nodiscard]]
+        float getMean() const
+        {
+            return mean.getCount() ? mean.get() : 0.0f;
+        }
+    };
+
+    /// Adds the time between its construction and destruction to a zone
+    class Scope
+    {
+    public:
+        explicit
+        Scope(Zone& zone);
+        ~Scope();
+
+        Scope(Scope const&) = delete;
+        Scope& operator=(Scope const&) = delete;
+
+    private:
+        Zone&                                 m_zone;
+        Zone*                                 m_parent;
+        std::chrono::steady_clock::time_point m_start;
+        /// Allocations made by the thread before entering the zone
+        uint64_t                              m_allocations;
+    };
+
+    static Profiler& get();
+
+    /// Creates a zone, its parent is the zone currently entered on the calling thread
+    Zone& createZone(char const* name);
+
+    /// Closes the current frame, should be called once per frame from the main thread
+    void endFrame();
+
+    /// Calls @p callback on each zone, children right after their parent
+    template<typename TCallback>
+    void foreach(TCallback&& callback)
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        foreachChild(nullptr, callback);
+    }
+
+    /// Mean duration of the last frames, in milliseconds
+    [[nodiscard]]
+    float getFrameTime() const
+    {
+        return m_frame_time.getCount() ? m_frame_time.get() : 0.0f;
+    }
+
+    [[nodiscard]]
+    RAccBase<float> const& getFrameHistory() const
+    {
+        return m_frame_history;
+    }
+
+private:
+    std::deque<Zone> m_zones;
+    std::mutex       m_mutex;
+
+    std::chrono::steady_clock::time_point m_frame_start = std::chrono::steady_clock::now();
+    RMean<float>                          m_frame_time{mean_frames_count};
+    RAccBase<float>                       m_frame_history{history_frames_count};
+
+    template<typename TCallback>
+    void foreachChild(Zone const* parent, TCallback& callback)
+    {
+        for (Zone& zone : m_zones) {
+            if (zone.parent == parent) {
+                callback(zone);
+                foreachChild(&zone, callback);
+            }
+        }
+    }
+};
+
+}
+
+#ifdef PEZ_PROFILING
+    #define PEZ_PROFILE_CONCAT_IMPL(a, b) a##b
+    #define PEZ_PROFILE_CONCAT(a, b) PEZ_PROFILE_CONCAT_IMPL(a, b)
+    /// Profiles the enclosing scope under the zone @p name, the zone is created the first time the scope is entered
+    #define PEZ_PROFILE_SCOPE(name) \
+        static pez::core::Profiler::Zone& PEZ_PROFILE_CONCAT(pez_profile_zone_, __LINE__) = pez::core::Profiler::get().createZone(name); \
+        pez::core::Profiler::Scope const PEZ_PROFILE_CONCAT(pez_profile_scope_, __LINE__){PEZ_PROFILE_CONCAT(pez_profile_zone_, __LINE__)}
+    #define PEZ_PROFILE_FRAME() pez::core::Profiler::get().endFrame()
+#else
+    #define PEZ_PROFILE_SCOPE(name)
+    #define PEZ_PROFILE_FRAME()
+#endif
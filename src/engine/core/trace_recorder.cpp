@@ -0,0 +1,135 @@
+#include "./trace_recorder.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+
+namespace
+{
+constexpr uint64_t phase_bit = uint64_t{1} << 63;
+
+void writeEscaped(std::ofstream& file, char const* str)
+{
+    for (; *str; ++str) {
+        if (*str == '"' || *str == '\\') {
+            file << '\\';
+        }
+        file << *str;
+    }
+}
+}
+
+pez::core::TraceRecorder& pez::core::TraceRecorder::get()
+{
+    static TraceRecorder recorder;
+    return recorder;
+}
+
+void pez::core::TraceRecorder::record(char const* name, Phase phase)
+{
+    if (!m_recording.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    auto const elapsed = std::chrono::steady_clock::now() - m_start;
+    auto const time    = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+
+    ThreadBuffer& buffer = getThreadBuffer();
+    uint64_t const index = buffer.claimed.load(std::memory_order_relaxed);
+    uint64_t const slot  = index % buffer_capacity;
+    // The claim has to be visible before the slot is overwritten
+    buffer.claimed.store(index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    buffer.times[slot].store(time | (phase == Phase::End ? phase_bit : 0), std::memory_order_relaxed);
+    buffer.names[slot].store(reinterpret_cast<uint64_t>(name), std::memory_order_relaxed);
+    buffer.committed.store(index + 1, std::memory_order_release);
+}
+
+void pez::core::TraceRecorder::setThreadName(std::string name)
+{
+    ThreadBuffer& buffer = getThreadBuffer();
+    std::lock_guard<std::mutex> lock{m_mutex};
+    buffer.name = std::move(name);
+}
+
+bool pez::core::TraceRecorder::dump(std::string const& filename)
+{
+    std::ofstream file{filename};
+    if (!file) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock{m_mutex};
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    auto const separator = [&]() {
+        if (!first) {
+            file << ",\n";
+        }
+        first = false;
+    };
+
+    std::vector<Event> events;
+    char timestamp[32];
+    for (auto const& buffer : m_buffers) {
+        separator();
+        file << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << buffer->id << R"(,"args":{"name":")";
+        writeEscaped(file, buffer->name.c_str());
+        file << "\"}}";
+
+        read(*buffer, events);
+        // The oldest events may have lost their beginning, unmatched ends are skipped
+        uint32_t depth = 0;
+        for (Event const& event : events) {
+            if (event.phase == Phase::End) {
+                if (depth == 0) {
+                    continue;
+                }
+                --depth;
+            } else {
+                ++depth;
+            }
+            std::snprintf(timestamp, sizeof(timestamp), "%.3f", static_cast<double>(event.time) * 1e-3);
+            separator();
+            file << "{\"name\":\"";
+            writeEscaped(file, event.name);
+            file << "\",\"ph\":\"" << (event.phase == Phase::Begin ? 'B' : 'E')
+                 << "\",\"ts\":" << timestamp << ",\"pid\":1,\"tid\":" << buffer->id << "}";
+        }
+    }
+    file << "]}\n";
+    return true;
+}
+
+pez::core::TraceRecorder::ThreadBuffer& pez::core::TraceRecorder::getThreadBuffer()
+{
+    // The buffer of the calling thread, created on its first event
+    thread_local ThreadBuffer* thread_buffer = nullptr;
+    if (!thread_buffer) {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        auto const id = static_cast<uint32_t>(m_buffers.size());
+        thread_buffer = m_buffers.emplace_back(std::make_unique<ThreadBuffer>(id)).get();
+    }
+    return *thread_buffer;
+}
+
+void pez::core::TraceRecorder::read(ThreadBuffer const& buffer, std::vector<Event>& events)
+{
+    events.clear();
+    uint64_t const committed = buffer.committed.load(std::memory_order_acquire);
+    uint64_t const begin     = committed > buffer_capacity ? committed - buffer_capacity : 0;
+    for (uint64_t i{begin}; i < committed; ++i) {
+        uint64_t const slot = i % buffer_capacity;
+        uint64_t const time = buffer.times[slot].load(std::memory_order_relaxed);
+        uint64_t const name = buffer.names[slot].load(std::memory_order_relaxed);
+        events.push_back({time & ~phase_bit, reinterpret_cast<char const*>(name), (time & phase_bit) ? Phase::End : Phase::Begin});
+    }
+
+    // Slots claimed by the owner thread during the copy may have been overwritten
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t const claimed     = buffer.claimed.load(std::memory_order_relaxed);
+    uint64_t const valid_begin = claimed > buffer_capacity ? claimed - buffer_capacity : 0;
+    if (valid_begin > begin) {
+        events.erase(events.begin(), events.begin() + static_cast<int64_t>(std::min(valid_begin - begin, events.size())));
+    }
+}
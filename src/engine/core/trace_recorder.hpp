@@ -0,0 +1,100 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+namespace pez::core
+{
+
+/** Records the begin and end of profiling zones on each thread, to be inspected offline
+ *
+ *  Each thread writes into its own ring buffer without locking, only the most recent events are kept. A dump can
+ *  be done at any time from any thread, events overwritten during the copy are discarded. The output is a Chrome
+ *  Trace Event JSON file, one lane per thread, that can be opened in chrome://tracing or Perfetto.
+ */
+class TraceRecorder
+{
+public:
+    /// Number of events kept per thread
+    static constexpr uint64_t buffer_capacity = 1 << 16;
+
+    enum class Phase : uint64_t
+    {
+        Begin = 0,
+        End   = 1
+    };
+
+    static TraceRecorder& get();
+
+    /// Records an event on the calling thread, @p name must outlive the recorder
+    void record(char const* name, Phase phase);
+
+    /// Name of the calling thread's lane
+    void setThreadName(std::string name);
+
+    void setRecording(bool recording)
+    {
+        m_recording = recording;
+    }
+
+    [[nodiscard]]
+    bool isRecording() const
+    {
+        return m_recording;
+    }
+
+    /// Writes the recorded events, returns false if the file cannot be created
+    bool dump(std::string const& filename);
+
+private:
+    /** The event words are atomics so that the copy done by @p dump while the owner thread writes is well defined,
+     *  @p claimed is incremented before writing a slot and @p committed after so overwritten slots can be detected.
+     */
+    struct ThreadBuffer
+    {
+        uint32_t    id;
+        std::string name;
+
+        /// Timestamp in nanoseconds with the phase in the highest bit, and name pointer
+        std::unique_ptr<std::atomic<uint64_t>[]> times;
+        std::unique_ptr<std::atomic<uint64_t>[]> names;
+
+        std::atomic<uint64_t> claimed   = 0;
+        std::atomic<uint64_t> committed = 0;
+
+        explicit
+        ThreadBuffer(uint32_t id_)
+            : id{id_}
+            , name{"Thread " + std::to_string(id_)}
+            , times{new std::atomic<uint64_t>[buffer_capacity]}
+            , names{new std::atomic<uint64_t>[buffer_capacity]}
+        {}
+    };
+
+    struct Event
+    {
+        uint64_t    time;
+        char const* name;
+        Phase       phase;
+    };
+
+    std::vector<std::unique_ptr<ThreadBuffer>> m_buffers;
+    std::mutex                                 m_mutex;
+    std::atomic<bool>                          m_recording = true;
+    std::chrono::steady_clock::time_point      m_start     = std::chrono::steady_clock::now();
+
+    ThreadBuffer& getThreadBuffer();
+    static void read(ThreadBuffer const& buffer, std::vector<Event>& events);
+};
+
+}
+
+#ifdef PEZ_PROFILING
+    #define PEZ_TRACE_THREAD(name) pez::core::TraceRecorder::get().setThreadName(name)
+#else
+    #define PEZ_TRACE_THREAD(name)
+#endif
@@ -4,6 +4,7 @@
 void pez::core::createSystems(uint32_t thread_count)
 {
     GlobalInstance::instance = std::make_unique<core::EngineInstance>();
+    PEZ_TRACE_THREAD("Main");
     // Create singletons provided by default by the engine
     createDefaultSingletons(thread_count);
 }
@@ -19,6 +20,10 @@ void pez::core::render(sf::Color clear_color)
     context.clear(clear_color);
     GlobalInstance::instance->m_entity_manager.render(context);
     context.display();
+    PEZ_PROFILE_FRAME();
+    AllocationTracker::endFrame();
+    // Transient data of this frame is not used anymore
+    FrameArena::endFrame();
 }
 
 void pez::core::update(float dt)
@@ -26,6 +31,26 @@ void pez::core::update(float dt)
     GlobalInstance::instance->update(dt);
 }
 
+void pez::core::updateFixed(float frame_dt)
+{
+    GlobalInstance::instance->updateFixed(frame_dt);
+}
+
+void pez::core::setFixedTimestep(float dt)
+{
+    GlobalInstance::instance->fixed_dt = dt;
+}
+
+float pez::core::getFixedTimestep()
+{
+    return GlobalInstance::instance->fixed_dt;
+}
+
+float pez::core::getInterpolation()
+{
+    return GlobalInstance::instance->interpolation;
+}
+
 uint64_t pez::core::getTick()
 {
     return GlobalInstance::instance->tick;
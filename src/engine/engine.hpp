@@ -1,6 +1,7 @@
 #pragma once
 #include <cstdint>
 
+#include "engine/core/frame_arena.hpp"
 #include "engine/core/instance.hpp"
 #include "engine/core/timer.hpp"
 #include "engine/render/render.hpp"
@@ -15,6 +16,12 @@ namespace pez::core
 void     createSystems(uint32_t thread_count = 0);
 void     quit();
 void     update(float dt);
+/// Advances the simulation by as many fixed steps as fit in @p frame_dt, the remainder is kept for next frame
+void     updateFixed(float frame_dt);
+void     setFixedTimestep(float dt);
+float    getFixedTimestep();
+/// Position between the last two fixed steps in [0, 1], used to interpolate the rendered state
+float    getInterpolation();
 void     render(sf::Color clear_color = sf::Color::Black);
 uint64_t getTick();
 float    getTime();
@@ -152,6 +159,7 @@ void registerProcessor(TArg&&... args)
     core::GlobalInstance::instance->m_entity_manager.registerProcessor<T>(std::forward<TArg>(args)...);
 }
 
+/// If the renderer is also an IProcessor, its update is called like other processors
 template<typename T, typename... TArg>
 static void registerRenderer(TArg&&... args)
 {
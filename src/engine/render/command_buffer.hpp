@@ -0,0 +1,507 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <vector>
+#include <SFML/Graphics.hpp>
+
+#include "glyph_source.hpp"
+#include "render_stats.hpp"
+
+
+namespace pez::render
+{
+
+/** Records the draws of a frame to submit them at once, sorted and merged.
+ *
+ *  Vertices are pre-transformed and converted to independent primitives (triangles, lines or points)
+ *  so that any two commands sharing the same texture, blend mode and primitive can be merged in a single draw.
+ *  Commands are only reordered inside a layer (see @p beginLayer), outside of layers submission order is kept.
+ */
+class CommandBuffer
+{
+public:
+    struct Command
+    {
+        uint32_t           layer      = 0;
+        uint32_t           order      = 0;
+        sf::Texture const* texture    = nullptr;
+        sf::BlendMode      blend_mode = sf::BlendAlpha;
+        sf::PrimitiveType  primitive  = sf::PrimitiveType::Triangles;
+        uint32_t           first      = 0;
+        uint32_t           count      = 0;
+        /// Render stats tag of the subsystem that recorded the command
+        uint32_t           tag        = 0;
+    };
+
+    CommandBuffer() = default;
+
+    /// Removes all recorded commands
+    void clear()
+    {
+        m_commands.clear();
+        m_vertices.clear();
+        m_layer       = 0;
+        m_layer_depth = 0;
+    }
+
+    /// Commands added until the matching @p endLayer can be reordered to reduce state changes
+    void beginLayer()
+    {
+        if (m_layer_depth++ == 0) {
+            ++m_layer;
+        }
+    }
+
+    void endLayer()
+    {
+        if (m_layer_depth > 0) {
+            --m_layer_depth;
+        }
+    }
+
+    /// Tag of the commands recorded from now on
+    void setTag(uint32_t tag)
+    {
+        m_tag = tag;
+    }
+
+    [[nodiscard]]
+    bool empty() const
+    {
+        return m_commands.empty();
+    }
+
+    [[nodiscard]]
+    size_t getCommandCount() const
+    {
+        return m_commands.size();
+    }
+
+    /** Tries to record a drawable, vertex arrays, sprites, shapes and texts can be recorded
+     *
+     * @return false if the drawable type is not supported, in this case nothing is recorded
+     */
+    bool add(sf::Drawable const& drawable, sf::RenderStates const& states)
+    {
+        if (auto const va = dynamic_cast<sf::VertexArray const*>(&drawable)) {
+            if (va->getVertexCount()) {
+                add(&(*va)[0], va->getVertexCount(), va->getPrimitiveType(), states);
+            }
+            return true;
+        }
+        if (auto const sprite = dynamic_cast<sf::Sprite const*>(&drawable)) {
+            addSprite(*sprite, states);
+            return true;
+        }
+        if (auto const shape = dynamic_cast<sf::Shape const*>(&drawable)) {
+            addShape(*shape, states);
+            return true;
+        }
+        if (auto const text = dynamic_cast<sf::Text const*>(&drawable)) {
+            addText(*text, states);
+            return true;
+        }
+        return false;
+    }
+
+    /// Lays out the texts using @p font with @p source instead of the font itself, null to remove
+    void setGlyphSource(sf::Font const& font, GlyphSource* source)
+    {
+        if (source) {
+            m_glyph_sources[&font] = source;
+        } else {
+            m_glyph_sources.erase(&font);
+        }
+    }
+
+    /// Horizontal advance of a glyph, from the glyph source of @p font if any
+    [[nodiscard]]
+    float getGlyphAdvance(sf::Font const& font, uint32_t codepoint, uint32_t character_size) const
+    {
+        FontGlyphs font_glyphs{font};
+        return getGlyphs(font, font_glyphs).getGlyph(codepoint, character_size).advance;
+    }
+
+    /// Local bounds of the glyphs of @p text, what sf::Text::getLocalBounds computes but without its font texture
+    [[nodiscard]]
+    sf::FloatRect getTextBounds(sf::Text const& text) const
+    {
+        sf::Font const* font = text.getFont();
+        if (!font) {
+            return {};
+        }
+        FontGlyphs font_glyphs{*font};
+        float min_x = 0.0f;
+        float min_y = 0.0f;
+        float max_x = 0.0f;
+        float max_y = 0.0f;
+        bool  empty = true;
+        layoutText(text, getGlyphs(*font, font_glyphs), [&](sf::Glyph const& glyph, float x, float y) {
+            float const left = x + glyph.bounds.left;
+            float const top  = y + glyph.bounds.top;
+            min_x = empty ? left : std::min(min_x, left);
+            min_y = empty ? top : std::min(min_y, top);
+            max_x = empty ? left + glyph.bounds.width : std::max(max_x, left + glyph.bounds.width);
+            max_y = empty ? top + glyph.bounds.height : std::max(max_y, top + glyph.bounds.height);
+            empty = false;
+        });
+        return {min_x, min_y, max_x - min_x, max_y - min_y};
+    }
+
+    /// Records raw vertices
+    void add(sf::Vertex const* vertices, size_t count, sf::PrimitiveType type, sf::RenderStates const& states)
+    {
+        Command& command = createCommand(states, getBatchPrimitive(type));
+        sf::Transform const& transform = states.transform;
+        auto const push = [&](size_t i) {
+            sf::Vertex v = vertices[i];
+            v.position   = transform.transformPoint(v.position);
+            m_vertices.push_back(v);
+        };
+
+        switch (type) {
+            case sf::PrimitiveType::TriangleStrip:
+                for (size_t i{2}; i < count; ++i) {
+                    push(i - 2);
+                    push(i - 1);
+                    push(i);
+                }
+                break;
+            case sf::PrimitiveType::TriangleFan:
+                for (size_t i{2}; i < count; ++i) {
+                    push(0);
+                    push(i - 1);
+                    push(i);
+                }
+                break;
+            case sf::PrimitiveType::Quads:
+                for (size_t i{0}; i + 3 < count; i += 4) {
+                    push(i + 0);
+                    push(i + 1);
+                    push(i + 2);
+                    push(i + 0);
+                    push(i + 2);
+                    push(i + 3);
+                }
+                break;
+            case sf::PrimitiveType::LineStrip:
+                for (size_t i{1}; i < count; ++i) {
+                    push(i - 1);
+                    push(i);
+                }
+                break;
+            default:
+                for (size_t i{0}; i < count; ++i) {
+                    push(i);
+                }
+                break;
+        }
+        command.count = static_cast<uint32_t>(m_vertices.size()) - command.first;
+    }
+
+    /** Sorts, merges and submits all recorded commands to @p target, the buffer is cleared afterward
+     *
+     * @param target Any object providing the sf::RenderTarget::draw overload taking raw vertices
+     * @param stats If not null, receives the draw calls and texture binds
+     */
+    template<typename TTarget>
+    void flush(TTarget& target, RenderStats* stats = nullptr)
+    {
+        if (m_commands.empty()) {
+            return;
+        }
+
+        std::sort(m_commands.begin(), m_commands.end(), [](Command const& c1, Command const& c2) {
+            if (c1.layer != c2.layer) {
+                return c1.layer < c2.layer;
+            }
+            if (c1.texture != c2.texture) {
+                return std::less<sf::Texture const*>{}(c1.texture, c2.texture);
+            }
+            uint32_t const blend_1 = getBlendKey(c1.blend_mode);
+            uint32_t const blend_2 = getBlendKey(c2.blend_mode);
+            if (blend_1 != blend_2) {
+                return blend_1 < blend_2;
+            }
+            if (c1.primitive != c2.primitive) {
+                return c1.primitive < c2.primitive;
+            }
+            return c1.order < c2.order;
+        });
+
+        m_batch.clear();
+        size_t batch_start = 0;
+        sf::Texture const* bound_texture = nullptr;
+        for (size_t i{0}; i < m_commands.size(); ++i) {
+            Command const& command = m_commands[i];
+            m_batch.insert(m_batch.end(), m_vertices.begin() + command.first, m_vertices.begin() + command.first + command.count);
+            // Submit when the next command cannot be merged with this one
+            bool const last = (i + 1 == m_commands.size());
+            if (last || !isCompatible(command, m_commands[i + 1])) {
+                if (m_batch.size() > batch_start) {
+                    sf::RenderStates states{command.blend_mode};
+                    states.texture = command.texture;
+                    target.draw(m_batch.data() + batch_start, m_batch.size() - batch_start, command.primitive, states);
+                    if (stats) {
+                        stats->addDrawCall(command.tag, command.texture && command.texture != bound_texture);
+                    }
+                    bound_texture = command.texture;
+                }
+                batch_start = m_batch.size();
+            }
+        }
+
+        m_commands.clear();
+        m_vertices.clear();
+    }
+
+private:
+    std::vector<Command>    m_commands;
+    std::vector<sf::Vertex> m_vertices;
+    std::vector<sf::Vertex> m_batch;
+    /// Temporary vertices of shapes and texts
+    std::vector<sf::Vertex> m_scratch;
+    std::unordered_map<sf::Font const*, GlyphSource*> m_glyph_sources;
+    uint32_t                m_layer       = 0;
+    uint32_t                m_layer_depth = 0;
+    uint32_t                m_tag         = 0;
+
+    Command& createCommand(sf::RenderStates const& states, sf::PrimitiveType primitive)
+    {
+        // Outside of layers, each command gets its own layer to keep submission order
+        if (m_layer_depth == 0) {
+            ++m_layer;
+        }
+        Command& command   = m_commands.emplace_back();
+        command.layer      = m_layer;
+        command.order      = static_cast<uint32_t>(m_commands.size());
+        command.texture    = states.texture;
+        command.blend_mode = states.blendMode;
+        command.primitive  = primitive;
+        command.first      = static_cast<uint32_t>(m_vertices.size());
+        command.tag        = m_tag;
+        return command;
+    }
+
+    void addSprite(sf::Sprite const& sprite, sf::RenderStates const& states)
+    {
+        sf::IntRect const rect   = sprite.getTextureRect();
+        auto const        width  = static_cast<float>(std::abs(rect.width));
+        auto const        height = static_cast<float>(std::abs(rect.height));
+        auto const        left   = static_cast<float>(rect.left);
+        auto const        top    = static_cast<float>(rect.top);
+        float const       right  = left + static_cast<float>(rect.width);
+        float const       bottom = top + static_cast<float>(rect.height);
+        sf::Color const   color  = sprite.getColor();
+
+        sf::Vertex const vertices[4] = {
+            {{0.0f, 0.0f}, color, {left, top}},
+            {{0.0f, height}, color, {left, bottom}},
+            {{width, 0.0f}, color, {right, top}},
+            {{width, height}, color, {right, bottom}},
+        };
+
+        sf::RenderStates sprite_states = states;
+        sprite_states.transform *= sprite.getTransform();
+        sprite_states.texture    = sprite.getTexture();
+        add(vertices, 4, sf::PrimitiveType::TriangleStrip, sprite_states);
+    }
+
+    /// Mimics sf::Shape geometry, a fan for the fill and a strip for the outline
+    void addShape(sf::Shape const& shape, sf::RenderStates const& states)
+    {
+        size_t const count = shape.getPointCount();
+        if (count < 3) {
+            return;
+        }
+
+        sf::RenderStates shape_states = states;
+        shape_states.transform *= shape.getTransform();
+
+        // Fill
+        sf::Vector2f center;
+        for (size_t i{0}; i < count; ++i) {
+            center += shape.getPoint(i);
+        }
+        center /= static_cast<float>(count);
+
+        sf::Texture const* texture = shape.getTexture();
+        sf::FloatRect const bounds = shape.getLocalBounds();
+        sf::IntRect const   rect   = shape.getTextureRect();
+        auto const tex_coords = [&](sf::Vector2f p) {
+            float const x = (bounds.width  > 0.0f) ? (p.x - bounds.left) / bounds.width  : 0.0f;
+            float const y = (bounds.height > 0.0f) ? (p.y - bounds.top)  / bounds.height : 0.0f;
+            return sf::Vector2f{static_cast<float>(rect.left) + static_cast<float>(rect.width) * x,
+                                static_cast<float>(rect.top)  + static_cast<float>(rect.height) * y};
+        };
+
+        sf::Color const fill = shape.getFillColor();
+        if (fill.a) {
+            m_scratch.clear();
+            m_scratch.emplace_back(center, fill, tex_coords(center));
+            for (size_t i{0}; i <= count; ++i) {
+                sf::Vector2f const p = shape.getPoint(i % count);
+                m_scratch.emplace_back(p, fill, tex_coords(p));
+            }
+            sf::RenderStates fill_states = shape_states;
+            fill_states.texture = texture;
+            add(m_scratch.data(), m_scratch.size(), sf::PrimitiveType::TriangleFan, fill_states);
+        }
+
+        // Outline, extruded along the normal of each point like SFML does
+        float const     thickness = shape.getOutlineThickness();
+        sf::Color const outline   = shape.getOutlineColor();
+        if (thickness == 0.0f || outline.a == 0) {
+            return;
+        }
+        m_scratch.clear();
+        for (size_t i{0}; i <= count; ++i) {
+            sf::Vector2f const p0 = shape.getPoint((i + count - 1) % count);
+            sf::Vector2f const p1 = shape.getPoint(i % count);
+            sf::Vector2f const p2 = shape.getPoint((i + 1) % count);
+            sf::Vector2f n1 = getNormal(p0, p1);
+            sf::Vector2f n2 = getNormal(p1, p2);
+            // Make sure normals point outside
+            if (dot(n1, center - p1) > 0.0f) {
+                n1 = -n1;
+            }
+            if (dot(n2, center - p1) > 0.0f) {
+                n2 = -n2;
+            }
+            float const        factor = 1.0f + dot(n1, n2);
+            sf::Vector2f const normal = (factor != 0.0f) ? (n1 + n2) / factor : n1;
+            m_scratch.emplace_back(p1, outline);
+            m_scratch.emplace_back(p1 + normal * thickness, outline);
+        }
+        sf::RenderStates outline_states = shape_states;
+        outline_states.texture = nullptr;
+        add(m_scratch.data(), m_scratch.size(), sf::PrimitiveType::TriangleStrip, outline_states);
+    }
+
+    /// Builds one quad per glyph
+    void addText(sf::Text const& text, sf::RenderStates const& states)
+    {
+        sf::Font const* font = text.getFont();
+        if (!font) {
+            return;
+        }
+
+        FontGlyphs      font_glyphs{*font};
+        GlyphSource&    glyphs = getGlyphs(*font, font_glyphs);
+        sf::Color const color  = text.getFillColor();
+        // Glyphs are padded in the font texture to avoid sampling their neighbors
+        float const padding = 1.0f;
+
+        m_scratch.clear();
+        layoutText(text, glyphs, [&](sf::Glyph const& glyph, float x, float y) {
+            float const left   = x + glyph.bounds.left - padding;
+            float const top    = y + glyph.bounds.top - padding;
+            float const right  = x + glyph.bounds.left + glyph.bounds.width + padding;
+            float const bottom = y + glyph.bounds.top + glyph.bounds.height + padding;
+            float const u1     = static_cast<float>(glyph.textureRect.left) - padding;
+            float const v1     = static_cast<float>(glyph.textureRect.top) - padding;
+            float const u2     = static_cast<float>(glyph.textureRect.left + glyph.textureRect.width) + padding;
+            float const v2     = static_cast<float>(glyph.textureRect.top + glyph.textureRect.height) + padding;
+            m_scratch.emplace_back(sf::Vector2f{left, top}, color, sf::Vector2f{u1, v1});
+            m_scratch.emplace_back(sf::Vector2f{right, top}, color, sf::Vector2f{u2, v1});
+            m_scratch.emplace_back(sf::Vector2f{left, bottom}, color, sf::Vector2f{u1, v2});
+            m_scratch.emplace_back(sf::Vector2f{left, bottom}, color, sf::Vector2f{u1, v2});
+            m_scratch.emplace_back(sf::Vector2f{right, top}, color, sf::Vector2f{u2, v1});
+            m_scratch.emplace_back(sf::Vector2f{right, bottom}, color, sf::Vector2f{u2, v2});
+        });
+
+        if (m_scratch.empty()) {
+            return;
+        }
+        sf::RenderStates text_states = states;
+        text_states.transform *= text.getTransform();
+        text_states.texture    = &glyphs.getTexture(text.getCharacterSize());
+        add(m_scratch.data(), m_scratch.size(), sf::PrimitiveType::Triangles, text_states);
+    }
+
+    /// Returns the glyph source registered for @p font, or @p fallback
+    GlyphSource& getGlyphs(sf::Font const& font, GlyphSource& fallback) const
+    {
+        auto const it = m_glyph_sources.find(&font);
+        return (it != m_glyph_sources.end()) ? *it->second : fallback;
+    }
+
+    /// Calls @p callback with each visible glyph and its pen position, following the layout of sf::Text (regular style, no outline)
+    template<typename TCallback>
+    static void layoutText(sf::Text const& text, GlyphSource& glyphs, TCallback&& callback)
+    {
+        uint32_t const    size         = text.getCharacterSize();
+        float const       whitespace   = glyphs.getGlyph(U' ', size).advance;
+        float const       line_spacing = glyphs.getLineSpacing(size);
+        sf::String const& str          = text.getString();
+
+        float    x    = 0.0f;
+        auto     y    = static_cast<float>(size);
+        uint32_t prev = 0;
+        for (size_t i{0}; i < str.getSize(); ++i) {
+            uint32_t const c = str[i];
+            x += glyphs.getKerning(prev, c, size);
+            prev = c;
+            if (c == U' ') {
+                x += whitespace;
+                continue;
+            }
+            if (c == U'\t') {
+                x += 4.0f * whitespace;
+                continue;
+            }
+            if (c == U'\n') {
+                y += line_spacing;
+                x = 0.0f;
+                continue;
+            }
+
+            sf::Glyph const& glyph = glyphs.getGlyph(c, size);
+            callback(glyph, x, y);
+            x += glyph.advance;
+        }
+    }
+
+    static float dot(sf::Vector2f v1, sf::Vector2f v2)
+    {
+        return v1.x * v2.x + v1.y * v2.y;
+    }
+
+    static sf::Vector2f getNormal(sf::Vector2f p1, sf::Vector2f p2)
+    {
+        sf::Vector2f const n{p1.y - p2.y, p2.x - p1.x};
+        float const length = std::sqrt(dot(n, n));
+        return (length > 0.0f) ? n / length : n;
+    }
+
+    static sf::PrimitiveType getBatchPrimitive(sf::PrimitiveType type)
+    {
+        switch (type) {
+            case sf::PrimitiveType::Points:
+                return sf::PrimitiveType::Points;
+            case sf::PrimitiveType::Lines:
+            case sf::PrimitiveType::LineStrip:
+                return sf::PrimitiveType::Lines;
+            default:
+                return sf::PrimitiveType::Triangles;
+        }
+    }
+
+    static uint32_t getBlendKey(sf::BlendMode const& mode)
+    {
+        return (static_cast<uint32_t>(mode.colorSrcFactor) << 20) |
+               (static_cast<uint32_t>(mode.colorDstFactor) << 16) |
+               (static_cast<uint32_t>(mode.colorEquation)  << 12) |
+               (static_cast<uint32_t>(mode.alphaSrcFactor) <<  8) |
+               (static_cast<uint32_t>(mode.alphaDstFactor) <<  4) |
+               (static_cast<uint32_t>(mode.alphaEquation));
+    }
+
+    static bool isCompatible(Command const& c1, Command const& c2)
+    {
+        return c1.texture == c2.texture && c1.primitive == c2.primitive && c1.blend_mode == c2.blend_mode;
+    }
+};
+
+}
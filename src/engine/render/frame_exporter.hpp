@@ -0,0 +1,224 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <SFML/Graphics.hpp>
+
+
+namespace pez::render
+{
+
+/** Writes rendered frames to disk from a background thread
+ *
+ *  Frames are copied into a fixed number of preallocated buffers and handed to the encoder thread through a
+ *  bounded queue. When all buffers are in use, @p push either waits for the encoder or drops the frame depending
+ *  on the overflow policy, waiting makes sense when rendering offscreen where only the output matters.
+ *
+ *  Supported outputs are raw Y4M video (4:4:4, BT.601 limited range) and numbered PNG images.
+ */
+class FrameExporter
+{
+public:
+    enum class Format
+    {
+        Y4M,
+        PNG
+    };
+
+    enum class Overflow
+    {
+        Wait,
+        Drop
+    };
+
+    /**
+     * @param path The Y4M file or the directory of the PNG sequence
+     * @param size The size of the frames in pixels
+     * @param fps The frame rate written in the Y4M header
+     * @param format The output format
+     * @param overflow What to do with a frame when the queue is full
+     * @param queue_size The number of frames that can be waiting for the encoder
+     */
+    FrameExporter(std::string path, sf::Vector2u size, uint32_t fps, Format format, Overflow overflow, uint32_t queue_size = 8)
+        : m_path{std::move(path)}
+        , m_size{size}
+        , m_fps{fps}
+        , m_format{format}
+        , m_overflow{overflow}
+        , m_buffers(queue_size)
+    {
+        for (auto& buffer : m_buffers) {
+            buffer.resize(4 * static_cast<size_t>(m_size.x) * m_size.y);
+            m_free.push_back(&buffer);
+        }
+
+        if (m_format == Format::Y4M) {
+            m_file.open(m_path, std::ios::binary);
+            m_file << "YUV4MPEG2 W" << m_size.x << " H" << m_size.y << " F" << m_fps << ":1 Ip A1:1 C444\n";
+            m_planes.resize(3 * static_cast<size_t>(m_size.x) * m_size.y);
+        } else {
+            std::filesystem::create_directories(m_path);
+        }
+
+        m_thread = std::thread([this]() {
+            run();
+        });
+    }
+
+    ~FrameExporter()
+    {
+        finish();
+    }
+
+    /** Queues a frame for encoding, the pixels are copied
+     *
+     * @param pixels RGBA pixels of a frame of the size given at construction
+     * @return false if the frame has been dropped
+     */
+    bool push(uint8_t const* pixels)
+    {
+        std::vector<uint8_t>* buffer = nullptr;
+        {
+            std::unique_lock<std::mutex> lock{m_mutex};
+            if (m_overflow == Overflow::Wait) {
+                m_condition.wait(lock, [this]() { return !m_free.empty() || m_done; });
+            }
+            if (m_free.empty() || m_done) {
+                ++m_dropped_count;
+                return false;
+            }
+            buffer = m_free.back();
+            m_free.pop_back();
+        }
+
+        // The copy is done outside of the lock, the buffer belongs to this thread until queued
+        std::copy(pixels, pixels + buffer->size(), buffer->begin());
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            m_ready.push_back(buffer);
+        }
+        m_condition.notify_all();
+        return true;
+    }
+
+    /// Waits for all queued frames to be written and stops the encoder
+    void finish()
+    {
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            if (m_done) {
+                return;
+            }
+            m_done = true;
+        }
+        m_condition.notify_all();
+        m_thread.join();
+        if (m_file.is_open()) {
+            m_file.close();
+        }
+    }
+
+    [[nodiscard]]
+    uint32_t getWrittenCount() const
+    {
+        return m_written_count;
+    }
+
+    [[nodiscard]]
+    uint32_t getDroppedCount() const
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        return m_dropped_count;
+    }
+
+private:
+    std::string   m_path;
+    sf::Vector2u  m_size;
+    uint32_t      m_fps;
+    Format        m_format;
+    Overflow      m_overflow;
+
+    std::vector<std::vector<uint8_t>>  m_buffers;
+    std::vector<std::vector<uint8_t>*> m_free;
+    std::deque<std::vector<uint8_t>*>  m_ready;
+    mutable std::mutex                 m_mutex;
+    std::condition_variable            m_condition;
+    bool                               m_done = false;
+
+    std::thread           m_thread;
+    std::ofstream         m_file;
+    std::vector<uint8_t>  m_planes;
+    std::atomic<uint32_t> m_written_count = 0;
+    uint32_t              m_dropped_count = 0;
+
+    void run()
+    {
+        while (true) {
+            std::vector<uint8_t>* buffer = nullptr;
+            {
+                std::unique_lock<std::mutex> lock{m_mutex};
+                m_condition.wait(lock, [this]() { return !m_ready.empty() || m_done; });
+                // Remaining frames are still written after finish has been called
+                if (m_ready.empty()) {
+                    return;
+                }
+                buffer = m_ready.front();
+                m_ready.pop_front();
+            }
+
+            write(*buffer);
+            ++m_written_count;
+
+            {
+                std::lock_guard<std::mutex> lock{m_mutex};
+                m_free.push_back(buffer);
+            }
+            m_condition.notify_all();
+        }
+    }
+
+    void write(std::vector<uint8_t> const& pixels)
+    {
+        if (m_format == Format::Y4M) {
+            writeY4M(pixels);
+        } else {
+            writePNG(pixels);
+        }
+    }
+
+    void writeY4M(std::vector<uint8_t> const& pixels)
+    {
+        size_t const pixel_count = static_cast<size_t>(m_size.x) * m_size.y;
+        uint8_t* y_plane = m_planes.data();
+        uint8_t* u_plane = y_plane + pixel_count;
+        uint8_t* v_plane = u_plane + pixel_count;
+        for (size_t i{0}; i < pixel_count; ++i) {
+            int32_t const r = pixels[4 * i + 0];
+            int32_t const g = pixels[4 * i + 1];
+            int32_t const b = pixels[4 * i + 2];
+            y_plane[i] = static_cast<uint8_t>((( 66 * r + 129 * g +  25 * b + 128) >> 8) +  16);
+            u_plane[i] = static_cast<uint8_t>(((-38 * r -  74 * g + 112 * b + 128) >> 8) + 128);
+            v_plane[i] = static_cast<uint8_t>(((112 * r -  94 * g -  18 * b + 128) >> 8) + 128);
+        }
+        m_file << "FRAME\n";
+        m_file.write(reinterpret_cast<char const*>(m_planes.data()), static_cast<std::streamsize>(m_planes.size()));
+    }
+
+    void writePNG(std::vector<uint8_t> const& pixels) const
+    {
+        char filename[32];
+        std::snprintf(filename, sizeof(filename), "frame_%06u.png", m_written_count.load());
+        sf::Image image;
+        image.create(m_size.x, m_size.y, pixels.data());
+        image.saveToFile((std::filesystem::path{m_path} / filename).string());
+    }
+};
+
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <cstdint>
+#include <SFML/Graphics.hpp>
+
+
+namespace pez::render
+{
+
+/** Glyph metrics and texture used to lay out texts
+ *
+ *  This allows to render texts without sf::Font, whose glyph pages are GPU textures.
+ */
+class GlyphSource
+{
+public:
+    virtual ~GlyphSource() = default;
+
+    [[nodiscard]]
+    virtual sf::Glyph const& getGlyph(uint32_t codepoint, uint32_t character_size) = 0;
+
+    [[nodiscard]]
+    virtual float getKerning(uint32_t first, uint32_t second, uint32_t character_size) = 0;
+
+    [[nodiscard]]
+    virtual float getLineSpacing(uint32_t character_size) = 0;
+
+    /// The texture the glyph rectangles refer to, glyphs are padded by at least 1 transparent texel
+    [[nodiscard]]
+    virtual sf::Texture const& getTexture(uint32_t character_size) = 0;
+};
+
+/// Forwards to a regular sf::Font
+class FontGlyphs : public GlyphSource
+{
+public:
+    explicit FontGlyphs(sf::Font const& font)
+        : m_font{font}
+    {}
+
+    [[nodiscard]]
+    sf::Glyph const& getGlyph(uint32_t codepoint, uint32_t character_size) override
+    {
+        return m_font.getGlyph(codepoint, character_size, false);
+    }
+
+    [[nodiscard]]
+    float getKerning(uint32_t first, uint32_t second, uint32_t character_size) override
+    {
+        return m_font.getKerning(first, second, character_size);
+    }
+
+    [[nodiscard]]
+    float getLineSpacing(uint32_t character_size) override
+    {
+        return m_font.getLineSpacing(character_size);
+    }
+
+    [[nodiscard]]
+    sf::Texture const& getTexture(uint32_t character_size) override
+    {
+        return m_font.getTexture(character_size);
+    }
+
+private:
+    sf::Font const& m_font;
+};
+
+}
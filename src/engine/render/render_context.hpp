@@ -1,9 +1,13 @@
 #pragma once
+#include <functional>
 #include "engine/common/vec.hpp"
 #include "engine/common/event_manager.hpp"
 #include <SFML/Graphics.hpp>
 
 #include "viewport_handler.hpp"
+#include "command_buffer.hpp"
+#include "render_stats.hpp"
+#include "software_rasterizer.hpp"
 
 
 namespace pez::render
@@ -12,6 +16,43 @@ namespace pez::render
 class Context
 {
 public:
+    /// Number of draws forwarded to the window versus skipped because they were off-screen
+    struct CullingStats
+    {
+        uint32_t submitted        = 0;
+        uint32_t culled           = 0;
+        uint64_t clipped_vertices = 0;
+        /// Drawables the software rasterizer cannot render, or whose texture it has no image of
+        uint32_t unsupported      = 0;
+    };
+
+    /// Receives the RGBA pixels of each rendered frame
+    using FrameCallback = std::function<void(uint8_t const* pixels, sf::Vector2u size)>;
+
+    /// Attributes the draws made during its lifetime to the subsystem @p name in the render stats
+    class StatsTag
+    {
+    public:
+        StatsTag(Context& context, char const* name)
+            : m_context{context}
+            , m_previous{context.m_tag}
+        {
+            m_context.setTag(m_context.m_stats.getTagIndex(name));
+        }
+
+        ~StatsTag()
+        {
+            m_context.setTag(m_previous);
+        }
+
+        StatsTag(StatsTag const&) = delete;
+        StatsTag& operator=(StatsTag const&) = delete;
+
+    private:
+        Context& m_context;
+        uint32_t m_previous;
+    };
+
     Context()  = default;
     ~Context() = default;
 
@@ -45,12 +86,144 @@ public:
 
     void clear(sf::Color color = sf::Color::Black)
     {
-        m_window->clear(color);
+        m_culling_stats = {};
+        m_stats.reset();
+        m_bound_texture = nullptr;
+        m_command_buffer.clear();
+        if (m_rasterizer) {
+            m_rasterizer->clear(color);
+        } else {
+            m_window->clear(color);
+        }
     }
 
     void display()
     {
-        m_window->display();
+        flush();
+        if (m_rasterizer) {
+            m_culling_stats.unsupported += m_rasterizer->getSkippedDraws();
+        }
+        m_last_stats         = m_stats;
+        m_last_culling_stats = m_culling_stats;
+        if (m_rasterizer) {
+            m_rasterizer->render();
+            if (m_frame_callback) {
+                m_frame_callback(m_rasterizer->getPixels(), m_rasterizer->getSize());
+            }
+        } else {
+            // The back buffer has to be read before being swapped
+            if (m_frame_callback) {
+                captureWindow();
+            }
+            m_window->display();
+        }
+    }
+
+    /** Sets a function called with the pixels of every frame, before it is displayed
+     *  With a window, pixels are read back from the GPU which stalls until the frame is rendered.
+     */
+    void setFrameCallback(FrameCallback callback)
+    {
+        m_frame_callback = std::move(callback);
+    }
+
+    /** Renders into @p rasterizer instead of the window
+     *
+     *  Every draw is then recorded in the command buffer whether batching is enabled or not, drawables
+     *  that cannot be recorded are skipped.
+     */
+    void setRasterizer(SoftwareRasterizer& rasterizer)
+    {
+        m_rasterizer = &rasterizer;
+        auto const size = static_cast<Vec2>(rasterizer.getSize());
+        m_viewport_handler.state.setCenter(size * 0.5f);
+    }
+
+    /// Returns the software rasterizer if rendering without window, nullptr otherwise
+    [[nodiscard]]
+    SoftwareRasterizer* getRasterizer() const
+    {
+        return m_rasterizer;
+    }
+
+    /// Provides the pixels of @p texture to the software rasterizer, does nothing when rendering to the window
+    void addTextureImage(sf::Texture const& texture, sf::Image const& image)
+    {
+        if (m_rasterizer) {
+            m_rasterizer->setTextureImage(&texture, &image);
+        }
+    }
+
+    /** Lets the software rasterizer draw the texts of @p font, does nothing when rendering to the window
+     *
+     *  sf::Font renders glyphs into GPU textures, the file is loaded again to render them on the CPU.
+     *
+     * @param font The font used by the texts
+     * @param filename The file @p font was loaded from
+     * @return false if the file could not be loaded
+     */
+    bool addFontFile(sf::Font const& font, std::string const& filename)
+    {
+        if (!m_rasterizer) {
+            return true;
+        }
+        SoftwareFont* const software_font = m_rasterizer->loadFont(filename);
+        m_command_buffer.setGlyphSource(font, software_font);
+        return software_font != nullptr;
+    }
+
+    /// Horizontal advance of a glyph, to use instead of sf::Font::getGlyph that needs a GPU
+    [[nodiscard]]
+    float getGlyphAdvance(sf::Font const& font, uint32_t codepoint, uint32_t character_size) const
+    {
+        return m_command_buffer.getGlyphAdvance(font, codepoint, character_size);
+    }
+
+    /// Bounds of @p text in its parent space, to use instead of sf::Text::getGlobalBounds that needs a GPU
+    [[nodiscard]]
+    sf::FloatRect getTextBounds(sf::Text const& text) const
+    {
+        return text.getTransform().transformRect(m_command_buffer.getTextBounds(text));
+    }
+
+    /** When enabled, vertex arrays, sprites, shapes and texts are recorded and submitted in merged batches at
+     *  @p display. Other drawables are still drawn immediately, after the pending commands.
+     */
+    void setBatching(bool enabled)
+    {
+        if (!enabled) {
+            flush();
+        }
+        m_batching = enabled;
+    }
+
+    [[nodiscard]]
+    bool isBatching() const
+    {
+        return m_batching;
+    }
+
+    /// Draws made until @p endLayer can be reordered by texture, blend mode and primitive type when batching
+    void beginLayer()
+    {
+        m_command_buffer.beginLayer();
+    }
+
+    void endLayer()
+    {
+        m_command_buffer.endLayer();
+    }
+
+    /// Submits all the recorded commands
+    void flush()
+    {
+        if (m_rasterizer) {
+            m_command_buffer.flush(*m_rasterizer, &m_stats);
+        } else {
+            m_command_buffer.flush(*m_window, &m_stats);
+        }
+        // Batches may have changed the texture used by the window
+        m_bound_texture = nullptr;
     }
 
     [[nodiscard]]
@@ -61,29 +234,158 @@ public:
 
     void draw(sf::Drawable& drawable)
     {
-        m_window->draw(drawable, m_viewport_handler.getTransform());
+        submit(drawable, m_viewport_handler.getTransform());
     }
 
     void draw(sf::Drawable& drawable, sf::Transform const& transform)
     {
-        m_window->draw(drawable, m_viewport_handler.getTransform() * transform);
+        m_stats.addTransform(m_tag);
+        submit(drawable, m_viewport_handler.getTransform() * transform);
     }
 
     void draw(sf::Drawable& drawable, sf::RenderStates const& states)
     {
+        m_stats.addTransform(m_tag);
         sf::RenderStates final_states = states;
         final_states.transform = m_viewport_handler.getTransform() * states.transform;
-        m_window->draw(drawable, final_states);
+        submit(drawable, final_states);
+    }
+
+    /** Draws @p drawable only if its bounds overlap the visible area
+     *
+     * @param drawable The object to draw
+     * @param local_bounds The bounds of the object before @p transform is applied
+     * @param transform The world transform of the object
+     * @return true if the object has been drawn, false if it has been culled
+     */
+    bool drawCulled(sf::Drawable& drawable, sf::FloatRect const& local_bounds, sf::Transform const& transform = sf::Transform::Identity)
+    {
+        if (!isVisible(transform.transformRect(local_bounds))) {
+            ++m_culling_stats.culled;
+            return false;
+        }
+        draw(drawable, transform);
+        return true;
+    }
+
+    /** Draws only the visible range of a vertex array, everything before the first
+     *  and after the last on-screen primitive is skipped.
+     *  Triangle fans share their first vertex and are only culled as a whole.
+     *
+     * @param va The vertex array, in world coordinates
+     * @return true if at least one primitive has been drawn
+     */
+    bool drawClipped(sf::VertexArray const& va)
+    {
+        if (va.getVertexCount() == 0) {
+            return false;
+        }
+        return drawClipped(&va[0], va.getVertexCount(), va.getPrimitiveType());
+    }
+
+    /// Same as above for a range of vertices, in world coordinates
+    bool drawClipped(sf::Vertex const* vertices, size_t vertex_count, sf::PrimitiveType type)
+    {
+        if (vertex_count == 0) {
+            return false;
+        }
+
+        if (type == sf::PrimitiveType::TriangleFan) {
+            if (!isVisible(getBounds(vertices, vertex_count))) {
+                ++m_culling_stats.culled;
+                return false;
+            }
+            submit(vertices, vertex_count, type, m_viewport_handler.getTransform());
+            return true;
+        }
+
+        // Vertices per primitive and offset between two consecutive primitives
+        size_t primitive_size = 1;
+        size_t stride         = 1;
+        switch (type) {
+            case sf::PrimitiveType::Lines:
+                primitive_size = stride = 2;
+                break;
+            case sf::PrimitiveType::LineStrip:
+                primitive_size = 2;
+                break;
+            case sf::PrimitiveType::Triangles:
+                primitive_size = stride = 3;
+                break;
+            case sf::PrimitiveType::TriangleStrip:
+                primitive_size = 3;
+                break;
+            case sf::PrimitiveType::Quads:
+                primitive_size = stride = 4;
+                break;
+            default:
+                break;
+        }
+
+        // Not a single whole primitive, nothing would be drawn
+        if (vertex_count < primitive_size) {
+            ++m_culling_stats.culled;
+            m_culling_stats.clipped_vertices += vertex_count;
+            return false;
+        }
+
+        sf::FloatRect const view_rect = getViewRect();
+        size_t first = vertex_count;
+        size_t last  = 0;
+        for (size_t i{0}; i + primitive_size <= vertex_count; i += stride) {
+            if (overlaps(view_rect, getBounds(vertices + i, primitive_size))) {
+                first = std::min(first, i);
+                last  = i + primitive_size;
+            }
+        }
+
+        if (first >= last) {
+            ++m_culling_stats.culled;
+            m_culling_stats.clipped_vertices += vertex_count;
+            return false;
+        }
+
+        m_culling_stats.clipped_vertices += vertex_count - (last - first);
+        submit(vertices + first, last - first, type, m_viewport_handler.getTransform());
+        return true;
     }
 
     void drawDirect(sf::Drawable const& drawable, sf::BlendMode mode = sf::BlendNone)
     {
-        m_window->draw(drawable);
+        submit(drawable, sf::RenderStates::Default);
     }
 
     void drawDirect(sf::Drawable& drawable, sf::Transform const& transform)
     {
-        m_window->draw(drawable, transform);
+        submit(drawable, transform);
+    }
+
+    /// Returns the world space rectangle currently visible on screen
+    [[nodiscard]]
+    sf::FloatRect getViewRect() const
+    {
+        return m_viewport_handler.state.getWorldRect();
+    }
+
+    /// Checks if a world space rectangle overlaps the visible area
+    [[nodiscard]]
+    bool isVisible(sf::FloatRect const& world_bounds) const
+    {
+        return overlaps(getViewRect(), world_bounds);
+    }
+
+    /// Returns the culling counters of the last displayed frame
+    [[nodiscard]]
+    CullingStats const& getCullingStats() const
+    {
+        return m_last_culling_stats;
+    }
+
+    /// Returns the counters of the last displayed frame
+    [[nodiscard]]
+    RenderStats const& getRenderStats() const
+    {
+        return m_last_stats;
     }
 
     [[nodiscard]]
@@ -105,9 +407,130 @@ public:
     }
 
 private:
-    IVec2             m_render_size       = {};
-    ViewportHandler   m_viewport_handler;
-    sf::RenderWindow* m_window            = nullptr;
+    IVec2               m_render_size      = {};
+    ViewportHandler     m_viewport_handler;
+    sf::RenderWindow*   m_window           = nullptr;
+    SoftwareRasterizer* m_rasterizer       = nullptr;
+    CullingStats        m_culling_stats;
+    CullingStats        m_last_culling_stats;
+    RenderStats         m_stats;
+    RenderStats         m_last_stats;
+    uint32_t            m_tag              = 0;
+    /// Last texture used by an immediate draw
+    sf::Texture const*  m_bound_texture    = nullptr;
+    CommandBuffer       m_command_buffer;
+    bool                m_batching         = false;
+    FrameCallback       m_frame_callback;
+    sf::Texture         m_capture_texture;
+
+    void captureWindow()
+    {
+        sf::Vector2u const size = m_window->getSize();
+        if (m_capture_texture.getSize() != size) {
+            m_capture_texture.create(size.x, size.y);
+        }
+        m_capture_texture.update(*m_window);
+        sf::Image const image = m_capture_texture.copyToImage();
+        m_frame_callback(image.getPixelsPtr(), size);
+    }
+
+    void setTag(uint32_t tag)
+    {
+        m_tag = tag;
+        m_command_buffer.setTag(tag);
+    }
+
+    void submit(sf::Drawable const& drawable, sf::RenderStates const& states)
+    {
+        ++m_culling_stats.submitted;
+        m_stats.addVertices(m_tag, getVertexCount(drawable));
+        // Transformable drawables combine their own transform with the states, whether recorded or drawn by SFML
+        if (dynamic_cast<sf::Transformable const*>(&drawable)) {
+            m_stats.addTransform(m_tag);
+        }
+        if ((m_batching || m_rasterizer) && m_command_buffer.add(drawable, states)) {
+            return;
+        }
+        if (m_rasterizer) {
+            ++m_culling_stats.unsupported;
+            return;
+        }
+        // The drawable cannot be deferred, pending commands have to be drawn first to keep draw order
+        flush();
+        addImmediateDrawCall(getTexture(drawable, states));
+        m_window->draw(drawable, states);
+    }
+
+    void submit(sf::Vertex const* vertices, size_t count, sf::PrimitiveType type, sf::RenderStates const& states)
+    {
+        ++m_culling_stats.submitted;
+        m_stats.addVertices(m_tag, count);
+        if (m_batching || m_rasterizer) {
+            m_command_buffer.add(vertices, count, type, states);
+            return;
+        }
+        addImmediateDrawCall(states.texture);
+        m_window->draw(vertices, count, type, states);
+    }
+
+    void addImmediateDrawCall(sf::Texture const* texture)
+    {
+        m_stats.addDrawCall(m_tag, texture && texture != m_bound_texture);
+        m_bound_texture = texture;
+    }
+
+    /// Number of vertices SFML generates to draw @p drawable, 0 for unknown types
+    static uint64_t getVertexCount(sf::Drawable const& drawable)
+    {
+        if (auto const va = dynamic_cast<sf::VertexArray const*>(&drawable)) {
+            return va->getVertexCount();
+        }
+        if (dynamic_cast<sf::Sprite const*>(&drawable)) {
+            return 4;
+        }
+        if (auto const shape = dynamic_cast<sf::Shape const*>(&drawable)) {
+            uint64_t const count   = shape->getPointCount();
+            uint64_t const outline = (shape->getOutlineThickness() != 0.0f) ? 2 * (count + 1) : 0;
+            return count + 2 + outline;
+        }
+        if (auto const text = dynamic_cast<sf::Text const*>(&drawable)) {
+            return 6 * text->getString().getSize();
+        }
+        return 0;
+    }
+
+    static sf::Texture const* getTexture(sf::Drawable const& drawable, sf::RenderStates const& states)
+    {
+        if (auto const sprite = dynamic_cast<sf::Sprite const*>(&drawable)) {
+            return sprite->getTexture();
+        }
+        if (auto const shape = dynamic_cast<sf::Shape const*>(&drawable)) {
+            return shape->getTexture();
+        }
+        if (auto const text = dynamic_cast<sf::Text const*>(&drawable)) {
+            return text->getFont() ? &text->getFont()->getTexture(text->getCharacterSize()) : nullptr;
+        }
+        return states.texture;
+    }
+
+    /// Unlike sf::Rect::intersects, degenerated rectangles (horizontal or vertical lines) are supported
+    static bool overlaps(sf::FloatRect const& r1, sf::FloatRect const& r2)
+    {
+        return r1.left <= r2.left + r2.width  && r2.left <= r1.left + r1.width &&
+               r1.top  <= r2.top  + r2.height && r2.top  <= r1.top  + r1.height;
+    }
+
+    static sf::FloatRect getBounds(sf::Vertex const* vertices, size_t count)
+    {
+        Vec2 min = vertices[0].position;
+        Vec2 max = min;
+        for (size_t i{1}; i < count; ++i) {
+            Vec2 const p = vertices[i].position;
+            min = {std::min(min.x, p.x), std::min(min.y, p.y)};
+            max = {std::max(max.x, p.x), std::max(max.y, p.y)};
+        }
+        return {min, max - min};
+    }
 
     void setWindow(sf::RenderWindow& window)
     {
@@ -117,5 +540,6 @@ private:
     }
 
     friend class WindowContextHandler;
+    friend class HeadlessContextHandler;
 };
 }
@@ -0,0 +1,89 @@
+#pragma once
+#include <array>
+#include <cstring>
+
+
+namespace pez::render
+{
+
+/** Counters of the work submitted by the render context during a frame, in total and per tag
+ *
+ *  Tags identify the subsystem making the draws (see Context::StatsTag), draws made outside of any tag are
+ *  attributed to the first one. When batching, a merged draw is attributed to the tag of its last command.
+ */
+struct RenderStats
+{
+    static constexpr uint32_t max_tags = 16;
+
+    struct Counters
+    {
+        /// Draws forwarded to the window or to the rasterizer
+        uint32_t draw_calls    = 0;
+        /// Vertices submitted to the context, before batching
+        uint64_t vertices      = 0;
+        /// Transforms combined on the CPU, by the context or by SFML
+        uint32_t transforms    = 0;
+        /// Changes of the texture used by consecutive draws
+        uint32_t texture_binds = 0;
+    };
+
+    Counters                             total;
+    std::array<Counters, max_tags>       tags      = {};
+    std::array<char const*, max_tags>    tag_names = {"Untagged"};
+    uint32_t                             tag_count = 1;
+
+    /// Returns the index of the tag @p name, creating it if needed, tags over @p max_tags are untagged
+    uint32_t getTagIndex(char const* name)
+    {
+        for (uint32_t i{0}; i < tag_count; ++i) {
+            if (std::strcmp(tag_names[i], name) == 0) {
+                return i;
+            }
+        }
+        if (tag_count == max_tags) {
+            return 0;
+        }
+        tag_names[tag_count] = name;
+        return tag_count++;
+    }
+
+    /// Clears the counters, tags are kept
+    void reset()
+    {
+        total = {};
+        tags.fill({});
+    }
+
+    void addDrawCall(uint32_t tag, bool texture_bind)
+    {
+        ++total.draw_calls;
+        ++tags[tag].draw_calls;
+        if (texture_bind) {
+            ++total.texture_binds;
+            ++tags[tag].texture_binds;
+        }
+    }
+
+    void addVertices(uint32_t tag, uint64_t count)
+    {
+        total.vertices     += count;
+        tags[tag].vertices += count;
+    }
+
+    void addTransform(uint32_t tag)
+    {
+        ++total.transforms;
+        ++tags[tag].transforms;
+    }
+
+    /// Calls @p callback with the name and counters of each tag
+    template<typename TCallback>
+    void foreachTag(TCallback&& callback) const
+    {
+        for (uint32_t i{0}; i < tag_count; ++i) {
+            callback(tag_names[i], tags[i]);
+        }
+    }
+};
+
+}
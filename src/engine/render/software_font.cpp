@@ -0,0 +1,139 @@
+#include "software_font.hpp"
+#include <algorithm>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+
+namespace pez::render
+{
+
+SoftwareFont::~SoftwareFont()
+{
+    if (m_face) {
+        FT_Done_Face(static_cast<FT_Face>(m_face));
+    }
+    if (m_library) {
+        FT_Done_FreeType(static_cast<FT_Library>(m_library));
+    }
+}
+
+bool SoftwareFont::loadFromFile(std::string const& filename)
+{
+    FT_Library library = nullptr;
+    if (FT_Init_FreeType(&library) != 0) {
+        return false;
+    }
+    FT_Face face = nullptr;
+    if (FT_New_Face(library, filename.c_str(), 0, &face) != 0) {
+        FT_Done_FreeType(library);
+        return false;
+    }
+    FT_Select_Charmap(face, FT_ENCODING_UNICODE);
+
+    m_library = library;
+    m_face    = face;
+    m_glyphs.clear();
+    m_atlas.create(atlas_width, 128, sf::Color{255, 255, 255, 0});
+    m_row_top    = 0;
+    m_row_height = 0;
+    m_row_x      = 0;
+    return true;
+}
+
+sf::Glyph const& SoftwareFont::getGlyph(uint32_t codepoint, uint32_t character_size)
+{
+    uint64_t const key = (static_cast<uint64_t>(character_size) << 32) | codepoint;
+    auto const it = m_glyphs.find(key);
+    if (it != m_glyphs.end()) {
+        return it->second;
+    }
+
+    // Missing glyphs are stored empty to not retry
+    sf::Glyph& glyph = m_glyphs[key];
+    auto const face  = static_cast<FT_Face>(m_face);
+    if (!setSize(character_size) || FT_Load_Char(face, codepoint, FT_LOAD_TARGET_NORMAL | FT_LOAD_FORCE_AUTOHINT) != 0) {
+        return glyph;
+    }
+    FT_GlyphSlot const slot = face->glyph;
+    if (slot->format != FT_GLYPH_FORMAT_BITMAP && FT_Render_Glyph(slot, FT_RENDER_MODE_NORMAL) != 0) {
+        return glyph;
+    }
+
+    FT_Bitmap const& bitmap = slot->bitmap;
+    glyph.advance = static_cast<float>(slot->advance.x >> 6);
+    glyph.bounds  = {static_cast<float>(slot->bitmap_left), -static_cast<float>(slot->bitmap_top),
+                     static_cast<float>(bitmap.width), static_cast<float>(bitmap.rows)};
+    if (bitmap.width == 0 || bitmap.rows == 0) {
+        return glyph;
+    }
+
+    sf::IntRect rect = allocate(bitmap.width + 2 * padding, bitmap.rows + 2 * padding);
+    rect.left   += padding;
+    rect.top    += padding;
+    rect.width   = static_cast<int32_t>(bitmap.width);
+    rect.height  = static_cast<int32_t>(bitmap.rows);
+    glyph.textureRect = rect;
+
+    // White texels with the coverage in alpha, like sf::Font, so that the vertex color tints them
+    for (uint32_t y{0}; y < bitmap.rows; ++y) {
+        uint8_t const* row = bitmap.buffer + static_cast<ptrdiff_t>(y) * bitmap.pitch;
+        for (uint32_t x{0}; x < bitmap.width; ++x) {
+            uint8_t const coverage = (bitmap.pixel_mode == FT_PIXEL_MODE_MONO)
+                                   ? (((row[x / 8] >> (7 - x % 8)) & 1) ? 255 : 0)
+                                   : row[x];
+            m_atlas.setPixel(rect.left + x, rect.top + y, sf::Color{255, 255, 255, coverage});
+        }
+    }
+    return glyph;
+}
+
+float SoftwareFont::getKerning(uint32_t first, uint32_t second, uint32_t character_size)
+{
+    auto const face = static_cast<FT_Face>(m_face);
+    if (first == 0 || second == 0 || !setSize(character_size) || !FT_HAS_KERNING(face)) {
+        return 0.0f;
+    }
+    FT_Vector kerning{0, 0};
+    if (FT_Get_Kerning(face, FT_Get_Char_Index(face, first), FT_Get_Char_Index(face, second), FT_KERNING_DEFAULT, &kerning) != 0) {
+        return 0.0f;
+    }
+    return static_cast<float>(kerning.x) / 64.0f;
+}
+
+float SoftwareFont::getLineSpacing(uint32_t character_size)
+{
+    if (!setSize(character_size)) {
+        return 0.0f;
+    }
+    return static_cast<float>(static_cast<FT_Face>(m_face)->size->metrics.height) / 64.0f;
+}
+
+bool SoftwareFont::setSize(uint32_t character_size)
+{
+    return m_face && FT_Set_Pixel_Sizes(static_cast<FT_Face>(m_face), 0, character_size) == 0;
+}
+
+sf::IntRect SoftwareFont::allocate(uint32_t width, uint32_t height)
+{
+    // Start a new row when the current one is full
+    if (m_row_x + width > atlas_width) {
+        m_row_top   += m_row_height;
+        m_row_x      = 0;
+        m_row_height = 0;
+    }
+    uint32_t const atlas_height = m_atlas.getSize().y;
+    if (m_row_top + height > atlas_height) {
+        sf::Image grown;
+        grown.create(atlas_width, std::max(2 * atlas_height, m_row_top + height), sf::Color{255, 255, 255, 0});
+        grown.copy(m_atlas, 0, 0);
+        m_atlas = grown;
+    }
+
+    sf::IntRect const rect{static_cast<int32_t>(m_row_x), static_cast<int32_t>(m_row_top),
+                           static_cast<int32_t>(width), static_cast<int32_t>(height)};
+    m_row_x     += width;
+    m_row_height = std::max(m_row_height, height);
+    return rect;
+}
+
+}
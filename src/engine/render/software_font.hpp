@@ -0,0 +1,72 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <SFML/Graphics.hpp>
+
+#include "glyph_source.hpp"
+
+
+namespace pez::render
+{
+
+/** A font whose glyphs are rendered with FreeType into an in-memory atlas, for the software rasterizer
+ *
+ *  All character sizes share the same atlas image, it grows in height when full and existing glyphs keep their
+ *  texture rectangle. The returned texture is never created, it only identifies the atlas for the rasterizer
+ *  (see SoftwareRasterizer::setTextureImage).
+ */
+class SoftwareFont : public GlyphSource
+{
+public:
+    SoftwareFont() = default;
+    ~SoftwareFont() override;
+
+    SoftwareFont(SoftwareFont const&) = delete;
+    SoftwareFont& operator=(SoftwareFont const&) = delete;
+
+    bool loadFromFile(std::string const& filename);
+
+    [[nodiscard]]
+    sf::Glyph const& getGlyph(uint32_t codepoint, uint32_t character_size) override;
+
+    [[nodiscard]]
+    float getKerning(uint32_t first, uint32_t second, uint32_t character_size) override;
+
+    [[nodiscard]]
+    float getLineSpacing(uint32_t character_size) override;
+
+    [[nodiscard]]
+    sf::Texture const& getTexture(uint32_t) override
+    {
+        return m_atlas_key;
+    }
+
+    [[nodiscard]]
+    sf::Image const& getImage() const
+    {
+        return m_atlas;
+    }
+
+private:
+    static constexpr uint32_t atlas_width = 512;
+    /// Transparent texels around each glyph
+    static constexpr uint32_t padding     = 1;
+
+    // FreeType types are kept out of the header
+    void* m_library = nullptr;
+    void* m_face    = nullptr;
+
+    /// Glyphs by character size in the upper half and codepoint in the lower half
+    std::unordered_map<uint64_t, sf::Glyph> m_glyphs;
+    sf::Image   m_atlas;
+    sf::Texture m_atlas_key;
+    /// Shelf packing, current row and position in it
+    uint32_t m_row_top    = 0;
+    uint32_t m_row_height = 0;
+    uint32_t m_row_x      = 0;
+
+    bool setSize(uint32_t character_size);
+    sf::IntRect allocate(uint32_t width, uint32_t height);
+};
+
+}
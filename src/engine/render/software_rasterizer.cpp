@@ -0,0 +1,366 @@
+#include "software_rasterizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "engine/common/thread_pool/thread_pool.hpp"
+
+
+namespace pez::render
+{
+
+namespace
+{
+
+float edge(sf::Vector2f a, sf::Vector2f b, sf::Vector2f c)
+{
+    return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+}
+
+/// With y pointing down, pixels exactly on a top or left edge belong to the triangle
+bool isTopLeft(sf::Vector2f a, sf::Vector2f b)
+{
+    float const dx = b.x - a.x;
+    float const dy = b.y - a.y;
+    return (dy == 0.0f && dx > 0.0f) || dy < 0.0f;
+}
+
+uint8_t toByte(float v)
+{
+    return static_cast<uint8_t>(std::min(std::max(v, 0.0f), 255.0f) + 0.5f);
+}
+
+}
+
+void SoftwareRasterizer::create(uint32_t width, uint32_t height, tp::ThreadPool* thread_pool)
+{
+    m_width       = width;
+    m_height      = height;
+    m_tiles_x     = static_cast<int32_t>((width + tile_size - 1) / tile_size);
+    m_tiles_y     = static_cast<int32_t>((height + tile_size - 1) / tile_size);
+    m_thread_pool = thread_pool;
+    m_pixels.assign(4 * static_cast<size_t>(width) * height, 0);
+    m_bins.resize(m_tiles_x * m_tiles_y);
+    m_triangles.clear();
+}
+
+void SoftwareRasterizer::clear(sf::Color color)
+{
+    for (size_t i{0}; i < m_pixels.size(); i += 4) {
+        m_pixels[i + 0] = color.r;
+        m_pixels[i + 1] = color.g;
+        m_pixels[i + 2] = color.b;
+        m_pixels[i + 3] = color.a;
+    }
+    m_triangles.clear();
+    for (auto& bin : m_bins) {
+        bin.clear();
+    }
+    m_skipped_draws = 0;
+}
+
+void SoftwareRasterizer::draw(sf::Vertex const* vertices, size_t count, sf::PrimitiveType type, sf::RenderStates const& states)
+{
+    sf::Image const* image = getImage(states.texture);
+    if (states.texture && !image) {
+        ++m_skipped_draws;
+        return;
+    }
+    Blend const      blend = getBlend(states.blendMode);
+    auto const transformed = [&](size_t i) {
+        sf::Vertex v = vertices[i];
+        v.position   = states.transform.transformPoint(v.position);
+        return v;
+    };
+
+    switch (type) {
+        case sf::PrimitiveType::Triangles:
+            for (size_t i{0}; i + 2 < count; i += 3) {
+                addTriangle(transformed(i), transformed(i + 1), transformed(i + 2), image, blend);
+            }
+            break;
+        case sf::PrimitiveType::TriangleStrip:
+            for (size_t i{2}; i < count; ++i) {
+                addTriangle(transformed(i - 2), transformed(i - 1), transformed(i), image, blend);
+            }
+            break;
+        case sf::PrimitiveType::TriangleFan:
+            for (size_t i{2}; i < count; ++i) {
+                addTriangle(transformed(0), transformed(i - 1), transformed(i), image, blend);
+            }
+            break;
+        case sf::PrimitiveType::Quads:
+            for (size_t i{0}; i + 3 < count; i += 4) {
+                addTriangle(transformed(i), transformed(i + 1), transformed(i + 2), image, blend);
+                addTriangle(transformed(i), transformed(i + 2), transformed(i + 3), image, blend);
+            }
+            break;
+        case sf::PrimitiveType::Lines:
+        case sf::PrimitiveType::LineStrip: {
+            size_t const stride = (type == sf::PrimitiveType::Lines) ? 2 : 1;
+            for (size_t i{0}; i + 1 < count; i += stride) {
+                sf::Vertex const v0 = transformed(i);
+                sf::Vertex const v1 = transformed(i + 1);
+                sf::Vector2f const d      = v1.position - v0.position;
+                float const        length = std::sqrt(d.x * d.x + d.y * d.y);
+                if (length == 0.0f) {
+                    continue;
+                }
+                // 1 pixel wide quad along the line
+                sf::Vector2f const n{-d.y / length * 0.5f, d.x / length * 0.5f};
+                addQuad(v0.position - n, d, 2.0f * n, v0, v1, image, blend);
+            }
+            break;
+        }
+        case sf::PrimitiveType::Points:
+            for (size_t i{0}; i < count; ++i) {
+                sf::Vertex const v = transformed(i);
+                addQuad(v.position - sf::Vector2f{0.5f, 0.5f}, {1.0f, 0.0f}, {0.0f, 1.0f}, v, v, image, blend);
+            }
+            break;
+    }
+}
+
+void SoftwareRasterizer::render()
+{
+    int32_t const tile_count = m_tiles_x * m_tiles_y;
+    if (m_thread_pool) {
+        // One tile per job since their cost varies a lot, idle threads steal from busy ones
+        m_thread_pool->parallelFor(0, static_cast<uint32_t>(tile_count), 1, [this](uint32_t begin, uint32_t end) {
+            for (uint32_t i{begin}; i < end; ++i) {
+                renderTile(static_cast<int32_t>(i));
+            }
+        });
+    } else {
+        for (int32_t i{0}; i < tile_count; ++i) {
+            renderTile(i);
+        }
+    }
+
+    m_triangles.clear();
+    for (auto& bin : m_bins) {
+        bin.clear();
+    }
+}
+
+void SoftwareRasterizer::setTextureImage(sf::Texture const* texture, sf::Image const* image)
+{
+    if (image) {
+        m_bound_images[texture] = image;
+    } else {
+        m_bound_images.erase(texture);
+    }
+}
+
+SoftwareFont* SoftwareRasterizer::loadFont(std::string const& filename)
+{
+    auto font = std::make_unique<SoftwareFont>();
+    if (!font->loadFromFile(filename)) {
+        return nullptr;
+    }
+    setTextureImage(&font->getTexture(0), &font->getImage());
+    return m_fonts.emplace_back(std::move(font)).get();
+}
+
+sf::Image SoftwareRasterizer::capture() const
+{
+    sf::Image image;
+    image.create(m_width, m_height, m_pixels.data());
+    return image;
+}
+
+sf::Image const* SoftwareRasterizer::getImage(sf::Texture const* texture)
+{
+    if (!texture) {
+        return nullptr;
+    }
+    auto const bound = m_bound_images.find(texture);
+    return (bound != m_bound_images.end()) ? bound->second : nullptr;
+}
+
+void SoftwareRasterizer::addTriangle(sf::Vertex const& v0, sf::Vertex const& v1, sf::Vertex const& v2, sf::Image const* image, Blend blend)
+{
+    Triangle& triangle = m_triangles.emplace_back();
+    triangle.vertices[0] = v0;
+    triangle.vertices[1] = v1;
+    triangle.vertices[2] = v2;
+    triangle.image = image;
+    triangle.blend = blend;
+    bin(static_cast<uint32_t>(m_triangles.size() - 1));
+}
+
+void SoftwareRasterizer::addQuad(sf::Vector2f p, sf::Vector2f u, sf::Vector2f v, sf::Vertex const& v0, sf::Vertex const& v1, sf::Image const* image, Blend blend)
+{
+    // The first edge takes the attributes of v0 and the opposite one those of v1
+    sf::Vertex a = v0;
+    sf::Vertex b = v1;
+    sf::Vertex c = v1;
+    sf::Vertex d = v0;
+    a.position = p;
+    b.position = p + u;
+    c.position = p + u + v;
+    d.position = p + v;
+    addTriangle(a, b, c, image, blend);
+    addTriangle(a, c, d, image, blend);
+}
+
+void SoftwareRasterizer::bin(uint32_t triangle_index)
+{
+    sf::Vertex const* v = m_triangles[triangle_index].vertices;
+    float const x_min = std::min({v[0].position.x, v[1].position.x, v[2].position.x});
+    float const y_min = std::min({v[0].position.y, v[1].position.y, v[2].position.y});
+    float const x_max = std::max({v[0].position.x, v[1].position.x, v[2].position.x});
+    float const y_max = std::max({v[0].position.y, v[1].position.y, v[2].position.y});
+    if (x_max < 0.0f || y_max < 0.0f || x_min >= static_cast<float>(m_width) || y_min >= static_cast<float>(m_height)) {
+        return;
+    }
+
+    int32_t const tx_min = std::max(static_cast<int32_t>(x_min) / tile_size, 0);
+    int32_t const ty_min = std::max(static_cast<int32_t>(y_min) / tile_size, 0);
+    int32_t const tx_max = std::min(static_cast<int32_t>(x_max) / tile_size, m_tiles_x - 1);
+    int32_t const ty_max = std::min(static_cast<int32_t>(y_max) / tile_size, m_tiles_y - 1);
+    for (int32_t ty{ty_min}; ty <= ty_max; ++ty) {
+        for (int32_t tx{tx_min}; tx <= tx_max; ++tx) {
+            m_bins[ty * m_tiles_x + tx].push_back(triangle_index);
+        }
+    }
+}
+
+void SoftwareRasterizer::renderTile(int32_t tile_index)
+{
+    int32_t const x_min = (tile_index % m_tiles_x) * tile_size;
+    int32_t const y_min = (tile_index / m_tiles_x) * tile_size;
+    int32_t const x_max = std::min(x_min + tile_size, static_cast<int32_t>(m_width)) - 1;
+    int32_t const y_max = std::min(y_min + tile_size, static_cast<int32_t>(m_height)) - 1;
+    for (uint32_t const triangle_index : m_bins[tile_index]) {
+        rasterize(m_triangles[triangle_index], x_min, y_min, x_max, y_max);
+    }
+}
+
+void SoftwareRasterizer::rasterize(Triangle const& triangle, int32_t x_min, int32_t y_min, int32_t x_max, int32_t y_max)
+{
+    sf::Vertex const* v0 = &triangle.vertices[0];
+    sf::Vertex const* v1 = &triangle.vertices[1];
+    sf::Vertex const* v2 = &triangle.vertices[2];
+    float area = edge(v0->position, v1->position, v2->position);
+    if (area == 0.0f) {
+        return;
+    }
+    // Use a single winding so that inside means positive edge functions
+    if (area < 0.0f) {
+        std::swap(v1, v2);
+        area = -area;
+    }
+    sf::Vector2f const p0 = v0->position;
+    sf::Vector2f const p1 = v1->position;
+    sf::Vector2f const p2 = v2->position;
+
+    x_min = std::max(x_min, static_cast<int32_t>(std::floor(std::min({p0.x, p1.x, p2.x}))));
+    y_min = std::max(y_min, static_cast<int32_t>(std::floor(std::min({p0.y, p1.y, p2.y}))));
+    x_max = std::min(x_max, static_cast<int32_t>(std::ceil(std::max({p0.x, p1.x, p2.x}))));
+    y_max = std::min(y_max, static_cast<int32_t>(std::ceil(std::max({p0.y, p1.y, p2.y}))));
+    if (x_min > x_max || y_min > y_max) {
+        return;
+    }
+
+    // Edge functions are evaluated incrementally
+    float const dx_12 = p1.y - p2.y;
+    float const dx_20 = p2.y - p0.y;
+    float const dx_01 = p0.y - p1.y;
+    float const dy_12 = p2.x - p1.x;
+    float const dy_20 = p0.x - p2.x;
+    float const dy_01 = p1.x - p0.x;
+    float const bias_0 = isTopLeft(p1, p2) ? 0.0f : -1e-6f;
+    float const bias_1 = isTopLeft(p2, p0) ? 0.0f : -1e-6f;
+    float const bias_2 = isTopLeft(p0, p1) ? 0.0f : -1e-6f;
+
+    sf::Vector2f const start{static_cast<float>(x_min) + 0.5f, static_cast<float>(y_min) + 0.5f};
+    float row_0 = edge(p1, p2, start);
+    float row_1 = edge(p2, p0, start);
+    float row_2 = edge(p0, p1, start);
+
+    float const inv_area = 1.0f / area;
+    sf::Image const* image = triangle.image;
+    uint8_t const* texels  = image ? image->getPixelsPtr() : nullptr;
+    auto const tex_width   = image ? static_cast<int32_t>(image->getSize().x) : 0;
+    auto const tex_height  = image ? static_cast<int32_t>(image->getSize().y) : 0;
+
+    for (int32_t y{y_min}; y <= y_max; ++y) {
+        float w0 = row_0;
+        float w1 = row_1;
+        float w2 = row_2;
+        uint8_t* pixel = &m_pixels[4 * (static_cast<size_t>(y) * m_width + x_min)];
+        for (int32_t x{x_min}; x <= x_max; ++x, pixel += 4) {
+            if (w0 + bias_0 >= 0.0f && w1 + bias_1 >= 0.0f && w2 + bias_2 >= 0.0f) {
+                float const b0 = w0 * inv_area;
+                float const b1 = w1 * inv_area;
+                float const b2 = w2 * inv_area;
+                float r = b0 * v0->color.r + b1 * v1->color.r + b2 * v2->color.r;
+                float g = b0 * v0->color.g + b1 * v1->color.g + b2 * v2->color.g;
+                float b = b0 * v0->color.b + b1 * v1->color.b + b2 * v2->color.b;
+                float a = b0 * v0->color.a + b1 * v1->color.a + b2 * v2->color.a;
+                if (texels && tex_width && tex_height) {
+                    float const u = b0 * v0->texCoords.x + b1 * v1->texCoords.x + b2 * v2->texCoords.x;
+                    float const v = b0 * v0->texCoords.y + b1 * v1->texCoords.y + b2 * v2->texCoords.y;
+                    int32_t const tx = std::min(std::max(static_cast<int32_t>(u), 0), tex_width - 1);
+                    int32_t const ty = std::min(std::max(static_cast<int32_t>(v), 0), tex_height - 1);
+                    uint8_t const* texel = &texels[4 * (ty * tex_width + tx)];
+                    r *= texel[0] / 255.0f;
+                    g *= texel[1] / 255.0f;
+                    b *= texel[2] / 255.0f;
+                    a *= texel[3] / 255.0f;
+                }
+
+                float const alpha = a / 255.0f;
+                switch (triangle.blend) {
+                    case Blend::Alpha:
+                        pixel[0] = toByte(r * alpha + pixel[0] * (1.0f - alpha));
+                        pixel[1] = toByte(g * alpha + pixel[1] * (1.0f - alpha));
+                        pixel[2] = toByte(b * alpha + pixel[2] * (1.0f - alpha));
+                        pixel[3] = toByte(a + pixel[3] * (1.0f - alpha));
+                        break;
+                    case Blend::Add:
+                        pixel[0] = toByte(pixel[0] + r * alpha);
+                        pixel[1] = toByte(pixel[1] + g * alpha);
+                        pixel[2] = toByte(pixel[2] + b * alpha);
+                        pixel[3] = toByte(pixel[3] + a);
+                        break;
+                    case Blend::Multiply:
+                        pixel[0] = toByte(pixel[0] * r / 255.0f);
+                        pixel[1] = toByte(pixel[1] * g / 255.0f);
+                        pixel[2] = toByte(pixel[2] * b / 255.0f);
+                        pixel[3] = toByte(pixel[3] * a / 255.0f);
+                        break;
+                    case Blend::None:
+                        pixel[0] = toByte(r);
+                        pixel[1] = toByte(g);
+                        pixel[2] = toByte(b);
+                        pixel[3] = toByte(a);
+                        break;
+                }
+            }
+            w0 += dx_12;
+            w1 += dx_20;
+            w2 += dx_01;
+        }
+        row_0 += dy_12;
+        row_1 += dy_20;
+        row_2 += dy_01;
+    }
+}
+
+SoftwareRasterizer::Blend SoftwareRasterizer::getBlend(sf::BlendMode const& mode)
+{
+    if (mode == sf::BlendAdd) {
+        return Blend::Add;
+    }
+    if (mode == sf::BlendMultiply) {
+        return Blend::Multiply;
+    }
+    if (mode == sf::BlendNone) {
+        return Blend::None;
+    }
+    return Blend::Alpha;
+}
+
+}
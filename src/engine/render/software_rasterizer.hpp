@@ -0,0 +1,119 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <SFML/Graphics.hpp>
+
+#include "software_font.hpp"
+
+
+namespace tp
+{
+struct ThreadPool;
+}
+
+namespace pez::render
+{
+
+/** Renders triangles, lines and points into an in-memory RGBA buffer, without GPU or window
+ *
+ *  Primitives are recorded with @p draw and rasterized at once by @p render. The screen is split into tiles and
+ *  each primitive is binned into the tiles its bounding box overlaps, tiles are then processed in parallel by the
+ *  thread pool while each tile keeps the submission order of its primitives.
+ *  Lines and points are drawn as 1 pixel wide quads, textures are sampled with the nearest texel.
+ *
+ *  Nothing here needs a GPU: textures are only used as keys to the images provided with @p setTextureImage,
+ *  and texts are drawn from fonts loaded with @p loadFont. Primitives using a texture without image are skipped.
+ */
+class SoftwareRasterizer
+{
+public:
+    /// Size in pixels of a screen tile side
+    static constexpr int32_t tile_size = 64;
+
+    SoftwareRasterizer() = default;
+
+    /// Allocates the color buffer, @p thread_pool can be null to render on the calling thread only
+    void create(uint32_t width, uint32_t height, tp::ThreadPool* thread_pool = nullptr);
+
+    /// Fills the color buffer and discards recorded primitives
+    void clear(sf::Color color);
+
+    /// Records primitives, strips and fans should already be converted to independent primitives (see CommandBuffer)
+    void draw(sf::Vertex const* vertices, size_t count, sf::PrimitiveType type, sf::RenderStates const& states);
+
+    /// Rasterizes all the primitives recorded since last @p render or @p clear
+    void render();
+
+    /// Uses @p image as the CPU copy of @p texture, null to remove the binding
+    void setTextureImage(sf::Texture const* texture, sf::Image const* image);
+
+    /// Loads a font rendered on the CPU and binds its atlas, returns null on failure
+    SoftwareFont* loadFont(std::string const& filename);
+
+    /// Number of draws skipped since last @p clear because their texture has no image
+    [[nodiscard]]
+    uint32_t getSkippedDraws() const
+    {
+        return m_skipped_draws;
+    }
+
+    [[nodiscard]]
+    sf::Vector2u getSize() const
+    {
+        return {m_width, m_height};
+    }
+
+    /// The color buffer, in RGBA order, row by row from the top
+    [[nodiscard]]
+    uint8_t const* getPixels() const
+    {
+        return m_pixels.data();
+    }
+
+    [[nodiscard]]
+    sf::Image capture() const;
+
+private:
+    enum class Blend : uint8_t
+    {
+        Alpha,
+        Add,
+        Multiply,
+        None
+    };
+
+    struct Triangle
+    {
+        sf::Vertex        vertices[3];
+        sf::Image const*  image = nullptr;
+        Blend             blend = Blend::Alpha;
+    };
+
+    uint32_t m_width  = 0;
+    uint32_t m_height = 0;
+    int32_t  m_tiles_x = 0;
+    int32_t  m_tiles_y = 0;
+    tp::ThreadPool* m_thread_pool = nullptr;
+
+    std::vector<uint8_t>               m_pixels;
+    std::vector<Triangle>              m_triangles;
+    /// Indexes of the triangles overlapping each tile, in submission order
+    std::vector<std::vector<uint32_t>> m_bins;
+
+    std::unordered_map<sf::Texture const*, sf::Image const*> m_bound_images;
+    std::vector<std::unique_ptr<SoftwareFont>>               m_fonts;
+    uint32_t                                                 m_skipped_draws = 0;
+
+    sf::Image const* getImage(sf::Texture const* texture);
+    void addTriangle(sf::Vertex const& v0, sf::Vertex const& v1, sf::Vertex const& v2, sf::Image const* image, Blend blend);
+    void addQuad(sf::Vector2f p, sf::Vector2f u, sf::Vector2f v, sf::Vertex const& v0, sf::Vertex const& v1, sf::Image const* image, Blend blend);
+    void bin(uint32_t triangle_index);
+    void renderTile(int32_t tile_index);
+    void rasterize(Triangle const& triangle, int32_t x_min, int32_t y_min, int32_t x_max, int32_t y_max);
+
+    static Blend getBlend(sf::BlendMode const& mode);
+};
+
+}
@@ -45,6 +45,15 @@ struct ViewportHandler
             center = c;
             updateState();
         }
+
+        /// Returns the world space rectangle covered by the render area
+        [[nodiscard]]
+        sf::FloatRect getWorldRect() const
+        {
+            Vec2 const top_left = -center / zoom - offset;
+            Vec2 const size     = 2.0f * center / zoom;
+            return {top_left, size};
+        }
     };
 
     State state;
@@ -4,11 +4,16 @@
 namespace pez::resources
 {
 
-ResourceManager::ResID ResourceManager::registerTexture(const std::string& filename, const std::string& asset_name)
+ResourceManager::ResID ResourceManager::registerTexture(const std::string& filename, const std::string& asset_name, bool upload)
 {
     const ResID id = textures.size();
     textures[id]   = std::make_unique<sf::Texture>();
-    textures[id]->loadFromFile(filename);
+    if (upload) {
+        textures[id]->loadFromFile(filename);
+    } else {
+        texture_images[id] = std::make_unique<sf::Image>();
+        texture_images[id]->loadFromFile(filename);
+    }
     //textures[id]->generateMipmap();
     //textures[id]->setSmooth(true);
     // Update name to id
@@ -33,6 +38,21 @@ sf::Texture& ResourceManager::getTexture(ResourceManager::ResID id)
     return *textures[id];
 }
 
+sf::Image const* ResourceManager::getTextureImage(ResourceManager::ResID id) const
+{
+    const auto it = texture_images.find(id);
+    return (it != texture_images.end()) ? it->second.get() : nullptr;
+}
+
+sf::Vector2u ResourceManager::getTextureSize(const std::string& name)
+{
+    const ResID id = name_to_id_textures[name];
+    if (const sf::Image* image = getTextureImage(id)) {
+        return image->getSize();
+    }
+    return textures[id]->getSize();
+}
+
 sf::Image& ResourceManager::getImage(ResourceManager::ResID id)
 {
     return *images[id];
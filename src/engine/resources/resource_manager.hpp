@@ -15,6 +15,8 @@ struct ResourceManager
     std::map<ResID, std::unique_ptr<sf::Texture>> textures;
     std::map<ResID, std::unique_ptr<sf::Image>>   images;
     std::map<ResID, std::unique_ptr<sf::Font>>    fonts;
+    /// CPU copies of the textures registered without upload
+    std::map<ResID, std::unique_ptr<sf::Image>>   texture_images;
 
     std::map<std::string, ResID> name_to_id_fonts;
     std::map<std::string, ResID> name_to_id_textures;
@@ -25,7 +27,8 @@ struct ResourceManager
     void clear();
 
     ResID registerFont(const std::string& filename, const std::string& asset_name);
-    ResID registerTexture(const std::string& filename, const std::string& asset_name);
+    /// Without @p upload the texture is left empty and the pixels are kept in an image, no GPU is required
+    ResID registerTexture(const std::string& filename, const std::string& asset_name, bool upload = true);
     ResID registerImage(const std::string& filename, const std::string& asset_name);
 
     sf::Texture& getTexture(ResID id);
@@ -35,6 +38,11 @@ struct ResourceManager
     sf::Texture& getTexture(const std::string& name);
     sf::Image&   getImage(const std::string& name);
 
+    /// The CPU copy of a texture registered without upload, nullptr otherwise
+    sf::Image const* getTextureImage(ResID id) const;
+    /// Size of the texture, or of its CPU copy if it was not uploaded
+    sf::Vector2u     getTextureSize(const std::string& name);
+
     ResID getImageID(const std::string& name);
 };
 }
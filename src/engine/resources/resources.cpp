@@ -6,7 +6,10 @@ namespace pez::resources
 
 ResourceManager::ResID registerFont(const std::string& filename, const std::string& asset_name)
 {
-    return ::pez::core::GlobalInstance::instance->m_resource_manager->registerFont(filename, asset_name);
+    auto& instance = *::pez::core::GlobalInstance::instance;
+    const ResourceManager::ResID id = instance.m_resource_manager->registerFont(filename, asset_name);
+    instance.m_render_context->addFontFile(instance.m_resource_manager->getFont(id), filename);
+    return id;
 }
 
 sf::Font& getFont(const std::string& asset_name)
@@ -16,7 +19,14 @@ sf::Font& getFont(const std::string& asset_name)
 
 ResourceManager::ResID registerTexture(const std::string& filename, const std::string& asset_name)
 {
-    return ::pez::core::GlobalInstance::instance->m_resource_manager->registerTexture(filename, asset_name);
+    auto& instance = *::pez::core::GlobalInstance::instance;
+    // Without window there may be no GPU, the software rasterizer samples a CPU copy instead
+    const bool upload = instance.m_render_context->getRasterizer() == nullptr;
+    const ResourceManager::ResID id = instance.m_resource_manager->registerTexture(filename, asset_name, upload);
+    if (const sf::Image* image = instance.m_resource_manager->getTextureImage(id)) {
+        instance.m_render_context->addTextureImage(instance.m_resource_manager->getTexture(id), *image);
+    }
+    return id;
 }
 
 sf::Texture& getTexture(const std::string& asset_name)
@@ -24,6 +34,11 @@ sf::Texture& getTexture(const std::string& asset_name)
     return ::pez::core::GlobalInstance::instance->m_resource_manager->getTexture(asset_name);
 }
 
+sf::Vector2u getTextureSize(const std::string& asset_name)
+{
+    return ::pez::core::GlobalInstance::instance->m_resource_manager->getTextureSize(asset_name);
+}
+
 sf::Image& getImage(const std::string &asset_name) {
     return ::pez::core::GlobalInstance::instance->m_resource_manager->getImage(asset_name);
 }
@@ -10,6 +10,7 @@ ResourceManager::ResID registerFont(const std::string& filename, const std::stri
 ResourceManager::ResID registerTexture(const std::string& filename, const std::string& asset_name);
 sf::Font&              getFont(const std::string& asset_name);
 sf::Texture&           getTexture(const std::string& asset_name);
+sf::Vector2u           getTextureSize(const std::string& asset_name);
 sf::Image&             getImage(const std::string& asset_name);
 
 }
@@ -0,0 +1,77 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include "engine/common/vec.hpp"
+#include "engine/common/event_manager.hpp"
+#include "engine/engine.hpp"
+#include "engine/render/software_rasterizer.hpp"
+
+namespace pez::render
+{
+/** Same role as WindowContextHandler without window nor GPU, frames are rendered by the software rasterizer.
+ *  Events can only come from a replay (see sfev::EventManager::startReplay), otherwise the application has to
+ *  drive the simulation by itself.
+ */
+class HeadlessContextHandler
+{
+public:
+    explicit
+    HeadlessContextHandler(UVec2 render_size, uint32_t thread_count = 0)
+    {
+        // Initialize Engine and its sub systems
+        pez::core::createSystems(thread_count);
+
+        m_rasterizer.create(render_size.x, render_size.y, &pez::core::getSingleton<tp::ThreadPool>());
+        m_render_context = pez::core::GlobalInstance::instance->m_render_context;
+        m_render_context->setRasterizer(m_rasterizer);
+        m_render_context->setRenderSize(static_cast<IVec2>(render_size));
+        m_render_context->registerCallbacks(m_event_manager, true);
+    }
+
+    ~HeadlessContextHandler() = default;
+
+    void exit()
+    {
+        m_running = false;
+    }
+
+    bool run()
+    {
+        m_event_manager.processEvents();
+        return m_running && !m_event_manager.isReplayFinished();
+    }
+
+    sfev::EventManager& getEventManager()
+    {
+        return m_event_manager;
+    }
+
+    [[nodiscard]]
+    Vec2 getWorldMousePosition() const
+    {
+        return m_render_context->m_viewport_handler.getMouseWorldPosition();
+    }
+
+    Context& getRenderContext()
+    {
+        return *m_render_context;
+    }
+
+    SoftwareRasterizer& getRasterizer()
+    {
+        return m_rasterizer;
+    }
+
+    /// Returns the last rendered frame
+    [[nodiscard]]
+    sf::Image capture() const
+    {
+        return m_rasterizer.capture();
+    }
+
+private:
+    SoftwareRasterizer m_rasterizer;
+    Context*           m_render_context = nullptr;
+    bool               m_running        = true;
+    sfev::EventManager m_event_manager{true};
+};
+}
@@ -87,7 +87,7 @@ public:
     bool run()
     {
         m_event_manager.processEvents();
-        return m_running;
+        return m_running && !m_event_manager.isReplayFinished();
     }
 
     sfev::EventManager& getEventManager()
@@ -115,6 +115,7 @@ public:
     void setMousePosition(sf::Vector2i position)
     {
         sf::Mouse::setPosition(position, m_window);
+        m_event_manager.refreshMousePosition();
         m_render_context->m_viewport_handler.setMousePosition(m_event_manager.getFloatMousePosition());
     }
 
@@ -1,15 +1,119 @@
 #include "engine/window/window_context_handler.hpp"
+#include "engine/window/headless_context_handler.hpp"
+#include "engine/render/frame_exporter.hpp"
 #include "user/initialize.hpp"
+#include "user/options.hpp"
 
 
-int32_t main()
+constexpr char const* signal_file = "signal.bin";
+constexpr char const* trace_file  = "trace.json";
+constexpr char const* graph_file  = "frame_graph.dot";
+
+/** Loads the signal and requests the coefficients given on the command line
+ *
+ *  Interactively, coefficients are streamed in as they are computed. When the output has to be reproducible, they are
+ *  added as soon as requested so that frames do not depend on the computation time.
+ */
+bool setupRenderer(Renderer& renderer, Options const& options)
 {
-    sf::ContextSettings settings;
-    settings.antialiasingLevel = 8;
-    pez::render::WindowContextHandler app("Fourier", conf::win::window_size, settings, sf::Style::Fullscreen, 1);
-    initialize();
+    renderer.synchronous_coefficients = options.headless || options.isExporting() || !options.record_path.empty() || !options.replay_path.empty();
+    if (!options.signal_path.empty() && !renderer.loadSignal(options.signal_path)) {
+        std::cout << "Cannot load signal " << options.signal_path << std::endl;
+        return false;
+    }
+    if (options.coefficient_count) {
+        renderer.requestCoefficients(options.coefficient_count);
+    }
+    return true;
+}
 
-    auto& renderer = pez::core::getRenderer<Renderer>();
+std::unique_ptr<pez::render::FrameExporter> createExporter(Options const& options, sf::Vector2u size, pez::render::FrameExporter::Overflow overflow)
+{
+    if (!options.isExporting()) {
+        return nullptr;
+    }
+    auto const format = options.isVideoExport() ? pez::render::FrameExporter::Format::Y4M : pez::render::FrameExporter::Format::PNG;
+    return std::make_unique<pez::render::FrameExporter>(options.export_path, size, options.fps, format, overflow);
+}
+
+void dumpTrace(std::string const& filename)
+{
+    if (pez::core::TraceRecorder::get().dump(filename)) {
+        std::cout << "Trace written to " << filename << std::endl;
+    } else {
+        std::cout << "Cannot write trace " << filename << std::endl;
+    }
+}
+
+/// Writes the frame graph of the last frame and prints its critical path
+void dumpFrameGraph(tp::TaskGraph const& graph, std::string const& filename)
+{
+    if (!graph.dump(filename)) {
+        std::cout << "Cannot write frame graph " << filename << std::endl;
+        return;
+    }
+    std::cout << "Frame graph written to " << filename << ", critical path:";
+    for (auto const id : graph.getCriticalPath()) {
+        std::cout << " [" << graph.getName(id) << " " << graph.getDuration(id) << " ms]";
+    }
+    std::cout << std::endl;
+}
+
+/// Duration of a simulation step
+float getFixedTimestep(Options const& options)
+{
+    return 1.0f / static_cast<float>(options.fps);
+}
+
+/** Sets up the inputs recording or replay requested on the command line
+ *
+ *  Mouse positions are recorded in pixels, a replay is refused if @p render_size differs from the recorded one
+ *  since the same pixels would then map to other world positions. It is also refused if the fixed timestep differs,
+ *  the recorded frame times would then be split in another number of simulation steps.
+ */
+bool setupInputs(sfev::EventManager& event_manager, Options const& options, sf::Vector2u render_size)
+{
+    float const fixed_timestep = getFixedTimestep(options);
+    if (!options.record_path.empty() && !event_manager.startRecording(options.record_path, render_size, fixed_timestep)) {
+        std::cout << "Cannot create inputs file " << options.record_path << std::endl;
+        return false;
+    }
+    if (!options.replay_path.empty()) {
+        if (!event_manager.startReplay(options.replay_path)) {
+            std::cout << "Cannot read inputs file " << options.replay_path << std::endl;
+            return false;
+        }
+        sf::Vector2u const recorded_size = event_manager.getReplayRenderSize();
+        if (recorded_size != render_size) {
+            std::cout << "Inputs were recorded with a " << recorded_size.x << "x" << recorded_size.y << " render size, "
+                      << "replay them with --size " << recorded_size.x << "x" << recorded_size.y << std::endl;
+            return false;
+        }
+        float const recorded_timestep = event_manager.getReplayFixedTimestep();
+        if (recorded_timestep != fixed_timestep) {
+            std::cout << "Inputs were recorded with " << 1.0f / recorded_timestep << " simulation steps per second, "
+                      << "replay them with --fps " << std::lround(1.0f / recorded_timestep) << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Returns false if the replay stopped on a damaged inputs file
+bool checkReplay(sfev::EventManager const& event_manager, Options const& options)
+{
+    if (event_manager.isReplayCorrupted()) {
+        std::cout << "Inputs file " << options.replay_path << " is corrupted after frame "
+                  << event_manager.getReplayFrame() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/// Controls available with and without window, so that recorded inputs can be replayed in both modes
+template<typename TApp>
+void registerControls(TApp& app, Renderer& renderer, Options const& options, bool& clicking)
+{
     app.getEventManager().addKeyPressedCallback(sf::Keyboard::S, [&](sfev::CstEv) {
         renderer.tracer.clear();
         renderer.addCoefficient();
@@ -29,8 +133,7 @@ int32_t main()
     });
 
     app.getEventManager().addKeyPressedCallback(sf::Keyboard::R, [&](sfev::CstEv) {
-        renderer.time = 0.0;
-        renderer.tracer.clear();
+        renderer.resetTime();
     });
 
     app.getEventManager().addKeyPressedCallback(sf::Keyboard::P, [&](sfev::CstEv) {
@@ -45,9 +148,30 @@ int32_t main()
         renderer.slow_mo = !renderer.slow_mo;
     });
 
-    bool clicking = false;
+    app.getEventManager().addKeyPressedCallback(sf::Keyboard::O, [&](sfev::CstEv) {
+        pez::core::getRenderer<ProfilerHUD>().toggle();
+    });
+
+    app.getEventManager().addKeyPressedCallback(sf::Keyboard::T, [&](sfev::CstEv) {
+        dumpTrace(options.trace_path.empty() ? trace_file : options.trace_path);
+    });
+
+    app.getEventManager().addKeyPressedCallback(sf::Keyboard::G, [&](sfev::CstEv) {
+        dumpFrameGraph(renderer.frame_graph, graph_file);
+    });
+
+    app.getEventManager().addKeyPressedCallback(sf::Keyboard::C, [&](sfev::CstEv) {
+        renderer.toggleCanvas();
+    });
+
+    app.getEventManager().addKeyPressedCallback(sf::Keyboard::W, [&](sfev::CstEv) {
+        renderer.signal.writeToFile(signal_file);
+        std::cout << "Signal saved to " << signal_file << std::endl;
+    });
+
     app.getEventManager().addMousePressedCallback(sf::Mouse::Right, [&](sfev::CstEv) {
         clicking = true;
+        renderer.cancelCoefficients();
         // If the signal is not empty, we have to bridge the gap with invisible padding points
         if (!renderer.signal.data.empty()) {
             renderer.signal.addPointFill(app.getWorldMousePosition(), false);
@@ -56,20 +180,144 @@ int32_t main()
     app.getEventManager().addMouseReleasedCallback(sf::Mouse::Right, [&](sfev::CstEv) {
         clicking = false;
     });
+}
+
+/// Simulates and renders one frame, @p frame_dt is replaced by the recorded one when replaying inputs
+template<typename TApp>
+void runFrame(TApp& app, Renderer& renderer, bool clicking, float frame_dt)
+{
+    if (clicking) {
+        // Coefficients of the previous signal are not needed anymore
+        renderer.cancelCoefficients();
+        Vec2 const mouse_position = app.getWorldMousePosition();
+        renderer.signal.addPoint(mouse_position, true);
+        renderer.signal.closeLoop();
+    }
+
+    pez::core::updateFixed(app.getEventManager().endFrame(frame_dt));
+    pez::core::render({80, 80, 80});
+}
+
+/// Renders the requested number of frames, or the whole replay, offscreen as fast as possible
+int32_t runHeadless(Options const& options)
+{
+    pez::render::HeadlessContextHandler app(options.render_size);
+    initialize();
+    app.getRenderContext().setBatching(true);
+
+    auto& renderer = pez::core::getRenderer<Renderer>();
+    renderer.draw_help = false;
+    if (!setupRenderer(renderer, options)) {
+        return 1;
+    }
+
+    // Offscreen, the encoder is the only limit so frames are never dropped
+    auto exporter = createExporter(options, app.getRasterizer().getSize(), pez::render::FrameExporter::Overflow::Wait);
+    if (exporter) {
+        app.getRenderContext().setFrameCallback([&](uint8_t const* pixels, sf::Vector2u) {
+            exporter->push(pixels);
+        });
+    }
+
+    bool clicking = false;
+    registerControls(app, renderer, options, clicking);
+    if (!setupInputs(app.getEventManager(), options, app.getRasterizer().getSize())) {
+        return 1;
+    }
+
+    // Exactly one simulation step per exported frame, unless replaying inputs which reproduces the recorded steps
+    float const dt = getFixedTimestep(options);
+    pez::core::setFixedTimestep(dt);
+    uint32_t allocating_frames = 0;
+    for (uint32_t i{0}; (options.frame_count == 0 || i < options.frame_count) && app.run(); ++i) {
+        runFrame(app, renderer, clicking, dt);
+        // Past the warm up, the steady state is expected to reuse the memory of the previous frames
+        auto const allocations = pez::core::AllocationTracker::getLastFrame();
+        if (options.allocation_check_frame >= 0 && i >= to<uint32_t>(options.allocation_check_frame) && allocations.count) {
+            std::cout << "Frame " << i << ": " << allocations.count << " allocations, " << allocations.bytes << " bytes" << std::endl;
+            ++allocating_frames;
+        }
+    }
+
+    if (exporter) {
+        exporter->finish();
+        std::cout << exporter->getWrittenCount() << " frames written to " << options.export_path << std::endl;
+    }
+    if (!options.trace_path.empty()) {
+        dumpTrace(options.trace_path);
+    }
+    if (!checkReplay(app.getEventManager(), options)) {
+        return 1;
+    }
+    if (allocating_frames) {
+        std::cout << allocating_frames << " frames allocated after frame " << options.allocation_check_frame << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+int32_t main(int32_t argc, char** argv)
+{
+    Options options;
+    if (!options.parse(argc, argv)) {
+        return 1;
+    }
+    if (options.headless) {
+        return runHeadless(options);
+    }
+
+    sf::ContextSettings settings;
+    settings.antialiasingLevel = 8;
+    pez::render::WindowContextHandler app("Fourier", options.render_size, settings, sf::Style::Fullscreen, 1);
+    initialize();
+    app.getRenderContext().setBatching(true);
+
+    auto& renderer = pez::core::getRenderer<Renderer>();
+    if (!setupRenderer(renderer, options)) {
+        return 1;
+    }
+
+    // The simulation uses a fixed step so a slow capture only slows down the window, dropping frames keeps it responsive
+    auto exporter = createExporter(options, app.getWindow().getSize(), pez::render::FrameExporter::Overflow::Drop);
+    uint32_t frame_count = 0;
+    if (exporter) {
+        app.getRenderContext().setFrameCallback([&](uint8_t const* pixels, sf::Vector2u) {
+            exporter->push(pixels);
+            ++frame_count;
+        });
+    }
+
+    bool clicking = false;
+    registerControls(app, renderer, options, clicking);
+    app.getEventManager().addKeyPressedCallback(sf::Keyboard::U, [&](sfev::CstEv) {
+        app.toggleUnlimitedFramerate();
+    });
+    if (!setupInputs(app.getEventManager(), options, app.getWindow().getSize())) {
+        return 1;
+    }
 
-    constexpr uint32_t fps_cap = 60;
-    const float dt = 1.0f / static_cast<float>(fps_cap);
+    // The simulation runs at a fixed rate whatever the frame rate
+    pez::core::setFixedTimestep(getFixedTimestep(options));
+    sf::Clock frame_clock;
 
     while (app.run()) {
-        if (clicking) {
-            Vec2 const mouse_position = app.getWorldMousePosition();
-            renderer.signal.addPoint(mouse_position, true);
-            renderer.signal.closeLoop();
+        // When exporting, each frame is one step so that the video is not affected by the capture speed
+        float const frame_dt = exporter ? pez::core::getFixedTimestep() : frame_clock.restart().asSeconds();
+        runFrame(app, renderer, clicking, frame_dt);
+
+        if (options.frame_count && frame_count >= options.frame_count) {
+            app.exit();
         }
+    }
 
-        pez::core::update(dt);
-        pez::core::render({80, 80, 80});
+    if (exporter) {
+        exporter->finish();
+        std::cout << exporter->getWrittenCount() << " frames written to " << options.export_path
+                  << ", " << exporter->getDroppedCount() << " dropped" << std::endl;
+    }
+    if (!options.trace_path.empty()) {
+        dumpTrace(options.trace_path);
     }
 
-    return 0;
+    return checkReplay(app.getEventManager(), options) ? 0 : 1;
 }
@@ -0,0 +1,245 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <vector>
+
+#include "engine/engine.hpp"
+#include "engine/common/thread_pool/algorithms.hpp"
+#include "engine/common/thread_pool/spsc_queue.hpp"
+
+#include "user/dft.hpp"
+
+
+/** Computes DFT coefficients on the thread pool and streams them to the renderer, from the most to the least energetic
+ *
+ *  The whole spectrum of each signal is computed once and sorted by descending norm, requested coefficients are then
+ *  pushed into a lock-free queue polled by the renderer at the beginning of its updates. The DFTs of the active mode
+ *  are computed and streamed first. When the queue is full the job returns, @p poll starts it again once there is
+ *  room so that no worker waits for the renderer.
+ */
+class CoefficientStream
+{
+public:
+    enum class Target : uint8_t
+    {
+        X,
+        Y,
+        Mono
+    };
+
+    struct Item
+    {
+        Target    target = Target::X;
+        DFT::Coef coef;
+    };
+
+    static constexpr uint32_t queue_capacity = 1024;
+
+    ~CoefficientStream()
+    {
+        stop();
+    }
+
+    /// True if the coefficients streamed so far belong to a signal that has been modified
+    [[nodiscard]]
+    bool isOutdated() const
+    {
+        return m_outdated;
+    }
+
+    /** Requests @p count more coefficients for each DFT
+     *
+     *  When outdated, the signals are copied and their spectra computed again, the receiving DFTs have to be cleared.
+     *
+     * @param mono_first Computes and streams the mono DFT before the X and Y ones
+     */
+    void request(uint32_t count, bool mono_first, std::vector<DFT::Complex> const& signal_x,
+                 std::vector<DFT::Complex> const& signal_y, std::vector<DFT::Complex> const& signal)
+    {
+        if (m_outdated) {
+            // The job has been stopped by invalidate
+            setSource(Target::X, signal_x);
+            setSource(Target::Y, signal_y);
+            setSource(Target::Mono, signal);
+            m_outdated = false;
+        }
+        for (Source& source : m_sources) {
+            source.requested += count;
+        }
+        m_mono_first = mono_first;
+        if (!isRunning()) {
+            start();
+        }
+    }
+
+    /// Stops streaming coefficients of the current signals, to be called when they are modified
+    void invalidate()
+    {
+        stop();
+        m_queue.clear();
+        m_outdated = true;
+    }
+
+    /** Calls @p callback on at most @p max_count received items
+     *
+     * @return The number of items received
+     */
+    template<typename TCallback>
+    uint32_t poll(uint32_t max_count, TCallback&& callback)
+    {
+        Item item;
+        uint32_t count = 0;
+        while (count < max_count && m_queue.pop(item)) {
+            callback(item);
+            ++count;
+        }
+        // Restarts the job once it stopped on a full queue, or if a request arrived while it was returning
+        if (!isRunning() && hasPending() && m_queue.getSize() < queue_capacity / 2) {
+            start();
+        }
+        return count;
+    }
+
+    /// Receives all the requested coefficients, blocking until they are computed
+    template<typename TCallback>
+    void wait(TCallback&& callback)
+    {
+        while (poll(queue_capacity, callback) || isRunning() || hasPending()) {
+            std::this_thread::yield();
+        }
+    }
+
+    void stop()
+    {
+        m_job.cancel();
+        m_job.take();
+    }
+
+private:
+    struct Source
+    {
+        std::vector<DFT::Complex> samples;
+        /// The whole spectrum sorted by descending norm, once computed
+        std::vector<DFT::Coef>    sorted;
+        std::vector<DFT::Coef>    sort_buffer;
+        bool                      computed  = false;
+        uint32_t                  published = 0;
+        /// Updated by the main thread while the job is running
+        std::atomic<uint32_t>     requested = 0;
+
+        [[nodiscard]]
+        bool isPending() const
+        {
+            return published < std::min(requested.load(), to<uint32_t>(samples.size()));
+        }
+    };
+
+    std::array<Source, 3>                     m_sources;
+    tp::SPSCQueue<Item, queue_capacity>       m_queue;
+    tp::Future<bool>                          m_job;
+    std::atomic<bool>                         m_mono_first = false;
+    bool                                      m_outdated   = true;
+
+    void setSource(Target target, std::vector<DFT::Complex> const& samples)
+    {
+        Source& source   = getSource(target);
+        source.samples   = samples;
+        source.computed  = false;
+        source.published = 0;
+        source.requested = 0;
+    }
+
+    [[nodiscard]]
+    Source& getSource(Target target)
+    {
+        return m_sources[static_cast<uint32_t>(target)];
+    }
+
+    [[nodiscard]]
+    bool isRunning() const
+    {
+        return m_job.isValid() && !m_job.isReady();
+    }
+
+    /// Only valid while the job is not running
+    [[nodiscard]]
+    bool hasPending() const
+    {
+        return !m_outdated && std::any_of(m_sources.begin(), m_sources.end(), [](Source const& source) {
+            return source.isPending();
+        });
+    }
+
+    void start()
+    {
+        m_job.take();
+        m_job = pez::core::getSingleton<tp::ThreadPool>().submit([this](tp::CancellationToken const& token) {
+            return produce(token);
+        });
+    }
+
+    /// Job body, returns false if stopped early by a full queue or a cancellation
+    bool produce(tp::CancellationToken const& token)
+    {
+        std::array<Target, 2> const dual{Target::X, Target::Y};
+        std::array<Target, 1> const mono{Target::Mono};
+        if (m_mono_first) {
+            return produceGroup(mono, token) && produceGroup(dual, token);
+        }
+        return produceGroup(dual, token) && produceGroup(mono, token);
+    }
+
+    /// Streams the coefficients of the DFTs displayed together, interleaved so that they appear at the same pace
+    template<size_t N>
+    bool produceGroup(std::array<Target, N> const& targets, tp::CancellationToken const& token)
+    {
+        for (Target const target : targets) {
+            if (!computeSpectrum(getSource(target), token)) {
+                return false;
+            }
+        }
+
+        bool pending = true;
+        while (pending) {
+            pending = false;
+            for (Target const target : targets) {
+                Source& source = getSource(target);
+                if (!source.isPending()) {
+                    continue;
+                }
+                if (token.isCancelled() || !m_queue.push({target, source.sorted[source.published]})) {
+                    return false;
+                }
+                ++source.published;
+                pending = true;
+            }
+        }
+        return true;
+    }
+
+    static bool computeSpectrum(Source& source, tp::CancellationToken const& token)
+    {
+        if (source.computed) {
+            return true;
+        }
+
+        auto& thread_pool = pez::core::getSingleton<tp::ThreadPool>();
+        auto const count  = to<uint32_t>(source.samples.size());
+        source.sorted.resize(count);
+        thread_pool.parallelFor(0, count, 16, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i{begin}; i < end && !token.isCancelled(); ++i) {
+                source.sorted[i] = DFT::computeCoefficient(source.samples, DFT::getRank(i));
+            }
+        });
+        if (token.isCancelled()) {
+            return false;
+        }
+
+        tp::sort(thread_pool, source.sorted, [](DFT::Coef const& c1, DFT::Coef const& c2) {
+            return c1.getNorm() > c2.getNorm();
+        }, source.sort_buffer);
+        source.computed = true;
+        return true;
+    }
+};
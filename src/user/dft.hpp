@@ -1,6 +1,10 @@
 #pragma once
+#include <complex>
+#include <iostream>
 
 #include "engine/common/math.hpp"
+#include "engine/common/utils.hpp"
+#include "engine/common/thread_pool/algorithms.hpp"
 
 /// Represents a DFT for a given signal
 struct DFT
@@ -60,18 +64,37 @@ struct DFT
             return;
         }
 
+        coefficients.push_back(computeCoefficient(*signal, i));
+    }
+
+    /** Computes the coefficient of rank @p i of @p samples
+     *
+     * @param samples The signal to transform
+     * @param i The rank of the coefficient to compute
+     * @return The coefficient, not divided by the number of samples
+     */
+    [[nodiscard]]
+    static Coef computeCoefficient(std::vector<Complex> const& samples, int32_t i)
+    {
         Coef result{i};
 
-        float const dx = Math::ConstantF32::TwoPi / to<float>(signal->size());
-        uint32_t k = 0;
-        for (auto const& sample : (*signal)) {
-            float const t = to<float>(k) * dx;
-            float const x = to<float>(i) * t;
-            result.v += sample * Complex{cos(x), -sin(x)};
-            ++k;
-        }
+        // Large signals are summed in parallel, always in the same order
+        float const dx = Math::ConstantF32::TwoPi / to<float>(samples.size());
+        result.v = tp::reduce(pez::core::getSingleton<tp::ThreadPool>(), to<uint32_t>(samples.size()), Complex{},
+            [&](uint32_t k) {
+                float const t = to<float>(k) * dx;
+                float const x = to<float>(i) * t;
+                return samples[k] * Complex{cos(x), -sin(x)};
+            },
+            std::plus<Complex>{});
+        return result;
+    }
 
-        coefficients.push_back(result);
+    /// Returns the rank of the @p index th coefficient in the sequence 0, 1, -1, 2, -2, 3, -3, etc...
+    [[nodiscard]]
+    static int32_t getRank(uint32_t index)
+    {
+        return (index % 2) ? to<int32_t>((index + 1) / 2) : -to<int32_t>(index / 2);
     }
 
     /** Adds the next coefficient in the list, alternating between negative and positive coefficient
@@ -2,6 +2,7 @@
 #include "engine/engine.hpp"
 
 #include "renderer.hpp"
+#include "profiler_hud.hpp"
 #include "user/machine/physic_system.hpp"
 
 void initialize()
@@ -11,4 +12,5 @@ void initialize()
 
     pez::core::registerProcessor<PhysicSystem>();
     pez::core::registerRenderer<Renderer>();
+    pez::core::registerRenderer<ProfilerHUD>();
 }
\ No newline at end of file
@@ -31,10 +31,12 @@ struct CartWheel
 
     void setWheelRadius(float radius)
     {
-        auto const& texture = pez::resources::getTexture("wheel");
+        // The texture is left empty when rendering without GPU, its size comes from the resources
+        auto const image_size   = pez::resources::getTextureSize("wheel");
+        auto const texture_size = to<Vec2>(image_size);
         wheel_radius = radius;
-        auto const texture_size = to<Vec2>(texture.getSize());
-        sprite.setTexture(texture);
+        sprite.setTexture(pez::resources::getTexture("wheel"));
+        sprite.setTextureRect({0, 0, to<int32_t>(image_size.x), to<int32_t>(image_size.y)});
         sprite.setOrigin(texture_size * 0.5f);
         float const scale = 2.0f * wheel_radius / texture_size.x;
         sprite.setScale(scale, scale);
@@ -45,7 +47,10 @@ struct CartWheel
         sf::Transform transform;
         transform.translate(position);
         transform.scale(wheel_radius, wheel_radius);
-        context.draw(shadow, transform);
+        if (!context.drawCulled(shadow, shadow.getBounds(), transform)) {
+            // The shadow is larger than the wheel, no need to test the sprite
+            return;
+        }
 
         sprite.setPosition(position);
         sprite.setRotation(Math::radToDeg(dist / wheel_radius));
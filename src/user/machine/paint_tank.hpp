@@ -22,6 +22,8 @@ struct PaintTank
 
     sf::Text text;
 
+    sf::CircleShape led;
+
     bool active = false;
 
     PaintTank()
@@ -43,12 +45,22 @@ struct PaintTank
         text.setFillColor({100, 100, 100});
         text.setCharacterSize(16);
         text.setString("Paint\ndispenser");
+
+        // Paint status LED
+        float const radius_led{4.0f};
+        led.setRadius(radius_led);
+        led.setOrigin(radius_led, radius_led);
+        led.setOutlineThickness(1.0f);
+        led.setOutlineColor(sf::Color{200, 200, 200});
     }
 
     void render(pez::render::Context& context)
     {
         back.position = position - size * 0.5f - Vec2{0.0f, 10.0f};
 
+        // Wheels do not overlap, shadows and sprites can be grouped in two batches
+        context.beginLayer();
+
         wheel_1.position = Vec2{back.position.x + offset, -conf::sim::world_size.y * 0.5f - wheel_1.wheel_radius - space};
         wheel_1.render(back.position.x, context);
 
@@ -60,23 +72,18 @@ struct PaintTank
 
         wheel_4.position = Vec2{back.position.x + size.x - offset, -conf::sim::world_size.y * 0.5f + wheel_4.wheel_radius};
         wheel_4.render(-back.position.x, context);
+        context.endLayer();
 
         back.render(context);
 
         Vec2 const text_offset = {7.0f, 58.0f};
         text.setPosition(back.position + text_offset);
-        context.draw(text);
-
-        float const radius_led{4.0f};
-        sf::CircleShape led(radius_led);
-        led.setOrigin(radius_led, radius_led);
+        context.drawCulled(text, context.getTextBounds(text));
 
         float const radius_coef = 1.5f;
         Vec2 const led_offset = {back.size.x - back.corner_radius * radius_coef, back.corner_radius * radius_coef};
         led.setPosition(back.position + led_offset);
         led.setFillColor(active ? sf::Color::Green : sf::Color{0, 100, 0});
-        led.setOutlineThickness(1.0f);
-        led.setOutlineColor(sf::Color{200, 200, 200});
         context.draw(led);
     }
 };
@@ -1,23 +1,131 @@
 #pragma once
 #include "engine/engine.hpp"
+#include "engine/common/double_object.hpp"
+#include "engine/common/thread_pool/inline_task.hpp"
+#include "engine/common/thread_pool/thread_pool.hpp"
 #include "user/configuration.hpp"
 #include "user/physic/solver.hpp"
 
 
+/// The position and orientation of the solver's objects at a given step
+struct PhysicSnapshot
+{
+    struct Body
+    {
+        pbd::Vec2D    position;
+        pbd::RealType angle = 0.0;
+    };
+
+    std::vector<Body> bodies;
+
+    void capture(pbd::Solver const& solver)
+    {
+        auto const& objects = solver.objects.getData();
+        bodies.resize(objects.size());
+        for (size_t i{0}; i < objects.size(); ++i) {
+            bodies[i].position = objects[i].getPosition();
+            bodies[i].angle    = objects[i].getAngle();
+        }
+    }
+
+    /// Linear interpolation of two snapshots of the same objects
+    void interpolate(PhysicSnapshot const& s1, PhysicSnapshot const& s2, pbd::RealType t)
+    {
+        bodies.resize(s2.bodies.size());
+        for (size_t i{0}; i < bodies.size(); ++i) {
+            Body const& b1 = s1.bodies[i];
+            Body const& b2 = s2.bodies[i];
+            bodies[i].position = b1.position + (b2.position - b1.position) * t;
+            bodies[i].angle    = b1.angle + (b2.angle - b1.angle) * t;
+        }
+    }
+
+    /// Same as pbd::Object::getWorldPosition using the snapshot's transform of @p object
+    [[nodiscard]]
+    pbd::Vec2D getWorldPosition(pbd::Object const& object, size_t i, uint32_t particle) const
+    {
+        Body const&         body = bodies[i];
+        pbd::Vec2D const    p    = object.particles[particle] - object.getCenterOfMass();
+        pbd::RealType const ca   = std::cos(body.angle);
+        pbd::RealType const sa   = std::sin(body.angle);
+        return body.position + pbd::Vec2D{ca * p.x - sa * p.y, sa * p.x + ca * p.y};
+    }
+};
+
+
+/** Steps the solver on the thread pool while the previous steps are rendered
+ *
+ *  Each update waits for the step launched by the previous one, publishes its result and launches the next step.
+ *  Rendering only reads the published snapshots, so it runs concurrently with the solver at the cost of one step
+ *  of latency. The solver must not be modified outside of the worker, changes are queued with @p edit and applied
+ *  between two steps.
+ */
 struct PhysicSystem : public pez::core::IProcessor
 {
     pbd::Solver solver;
 
+    /// States after the last two completed steps, the front one being the most recent
+    DoubleObject<PhysicSnapshot> states;
+    PhysicSnapshot               render_state;
+
+    /// Modifications of the solver waiting for the running step to complete, stored inline to avoid allocating
+    std::vector<tp::InlineTask> commands;
+    /// Completed when the running step is done
+    tp::Latch                   step_latch;
+
     PhysicSystem()
     {
         solver.gravity = {0.0f, 2000.0f};
 
         createObjects();
+        states.getFront().capture(solver);
+        states.getBack().capture(solver);
     }
 
     void update(float dt) override
     {
-        solver.update(dt);
+        waitStep();
+
+        states.swap();
+        states.getFront().capture(solver);
+
+        for (tp::InlineTask& command : commands) {
+            command();
+        }
+        commands.clear();
+
+        step_latch.add();
+        pez::core::getSingleton<tp::ThreadPool>().addTask([this, dt]() {
+            solver.update(dt);
+            step_latch.done();
+        });
+    }
+
+    void stop() override
+    {
+        waitStep();
+    }
+
+    /// Queues a modification of the solver, it will be applied before the next step
+    template<typename TCallback>
+    void edit(TCallback&& callback)
+    {
+        commands.emplace_back([this, callback = std::forward<TCallback>(callback)]() mutable {
+            callback(solver);
+        });
+    }
+
+    /// Returns the state of the objects interpolated between the last two completed steps
+    [[nodiscard]]
+    PhysicSnapshot const& getRenderState()
+    {
+        render_state.interpolate(states.getBack(), states.getFront(), pez::core::getInterpolation());
+        return render_state;
+    }
+
+    void waitStep()
+    {
+        step_latch.wait();
     }
 
     void createObjects()
@@ -33,9 +141,7 @@ struct PhysicSystem : public pez::core::IProcessor
         segment->particles.emplace_back(conf::sim::world_size.x * 0.75, 0.0f);
         segment->computeProperties();
         segment->setPositionInstant({0.0f, -conf::sim::world_size.y * 0.5f + 30.0f});
-        segment->moving = false;
-        segment->inv_inertia_tensor = 0.0;
-        segment->inv_mass = 0.0;
+        segment->makeStatic();
 
         auto last_obj = solver.createObject();
         last_obj->particles.emplace_back(0.0f, 0.0f);
@@ -1,6 +1,8 @@
 #pragma once
+#include <array>
 #include "engine/engine.hpp"
 #include "user/physic/solver.hpp"
+#include "user/machine/physic_system.hpp"
 
 /** A physics based tube connecting the paint tank to the cursor.
  *
@@ -15,15 +17,18 @@ struct Tube
     pbd::Solver&      solver;
     // The number of segments, provided by the solver
     size_t const      segments_count;
-    // The vertex array used to draw the tube
-    sf::VertexArray   va_segments;
+    // The vertex arrays used to draw the tube, one per layer
+    std::array<sf::VertexArray, 4> layers;
+    uint32_t                       layers_count = 0;
 
     Tube()
         : solver{pez::core::getProcessor<PhysicSystem>().solver}
         , segments_count(solver.objects.size() - object_offset)
-        , va_segments{sf::PrimitiveType::TriangleStrip, 2 * segments_count}
     {
-
+        for (sf::VertexArray& va : layers) {
+            va.setPrimitiveType(sf::PrimitiveType::TriangleStrip);
+            va.resize(2 * segments_count);
+        }
     }
 
     /** Checks if the segment @p i is filled with paint given the current @p time
@@ -43,7 +48,7 @@ struct Tube
         return signal.getFlag(idx);
     }
 
-    /** Update the tube's rigidity depending on paint presence
+    /** Update the tube's rigidity depending on paint presence, must not be called while the solver is running
      *
      * @param signal The current signal
      * @param time The current time
@@ -66,49 +71,63 @@ struct Tube
         }
     }
 
-    /** Renders the tube
+    /** Computes the tube's geometry without drawing it, does not use the render context so it can run on any thread
      *
      * @param signal The current signal
      * @param time The current time
-     * @param context The render context to use
+     * @param state The state of the objects to draw, the solver itself may be running
      */
-    void render(Signal const& signal, float time, pez::render::Context& context)
+    void update(Signal const& signal, float time, PhysicSnapshot const& state)
     {
-        renderTube(8.0, sf::Color::White, context);
+        PEZ_PROFILE_SCOPE("Tube::update");
+        layers_count = 0;
+        updateLayer(8.0, sf::Color::White, state);
 
         if (!signal.data.empty()) {
-            renderTube(6.0, {50, 50, 50}, context);
+            updateLayer(6.0, {50, 50, 50}, state);
             // Generate paint
-            renderTubeCallback(6.0, [&](uint32_t i) -> sf::Color {
+            updateLayerCallback(6.0, [&](uint32_t i) -> sf::Color {
                 return getSegmentPaintStatus(signal, time, i) ? sf::Color{231, 111, 81} : sf::Color{231, 111, 81, 0};
-            }, context);
-            renderTube(6.0, {255, 255, 255, 100}, context);
+            }, state);
+            updateLayer(6.0, {255, 255, 255, 100}, state);
+        }
+    }
+
+    /// Draws the geometry computed by the last call to @p update
+    void render(pez::render::Context& context)
+    {
+        PEZ_PROFILE_SCOPE("Tube::render");
+        pez::render::Context::StatsTag const stats_tag{context, "Tube"};
+        for (uint32_t i{0}; i < layers_count; ++i) {
+            context.drawClipped(layers[i]);
         }
     }
 
 private:
-    /** Renders an path matching the tube's current geometry with customizable color per segment
+    /** Computes the next layer, a path matching the tube's current geometry with customizable color per segment
      *
      * @tparam TCallback Any callable that takes an @p uint32_t and returns a @p sf::Color
      * @param width The width of the path
      * @param color_callback A callback that tells the color of each segment
-     * @param context The context to use to draw the path
+     * @param state The state of the objects to draw
      */
     template<typename TCallback>
-    void renderTubeCallback(pbd::RealType width, TCallback&& color_callback, pez::render::Context& context)
+    void updateLayerCallback(pbd::RealType width, TCallback&& color_callback, PhysicSnapshot const& state)
     {
         uint32_t const  offset = 1;
 
         auto const& objects = solver.objects.getData();
+        sf::VertexArray& va_segments = layers[layers_count++];
 
         pbd::Vec2D current;
         pbd::Vec2D d;
         pbd::Vec2D n;
-        pbd::Vec2D last = objects[offset].getWorldPosition(0);
+        pbd::Vec2D last = state.getWorldPosition(objects[offset], offset, 0);
 
         for (uint32_t i{offset}; i < segments_count + offset; ++i) {
-            auto const pt = objects[i];
-            current = pt.getWorldPosition(1);
+            // Only the local geometry is read, it is not modified by the solver
+            auto const& pt = objects[i];
+            current = state.getWorldPosition(pt, i, 1);
             d = current - last;
             n = MathVec2::normalize(MathVec2::normal(d));
             sf::Color const color = color_callback(i);
@@ -118,12 +137,11 @@ private:
             va_segments[2 * (i - offset) + 1].color = color;
             last = current;
         }
-        context.draw(va_segments);
     }
 
-    /// Helper function that draw a path with one color
-    void renderTube(pbd::RealType width, sf::Color color, pez::render::Context& context)
+    /// Helper function that computes a layer with one color
+    void updateLayer(pbd::RealType width, sf::Color color, PhysicSnapshot const& state)
     {
-        renderTubeCallback(width, [&](uint32_t) { return  color; }, context);
+        updateLayerCallback(width, [&](uint32_t) { return  color; }, state);
     }
 };
\ No newline at end of file
@@ -0,0 +1,110 @@
+#pragma once
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "engine/common/vec.hpp"
+#include "engine/core/allocation_tracker.hpp"
+#include "user/configuration.hpp"
+
+
+/// Command line options
+struct Options
+{
+    /// Render without window using the software rasterizer
+    bool        headless          = false;
+    /// Output of the frame export, a .y4m file or a directory for a PNG sequence, empty to disable export
+    std::string export_path;
+    /// Number of frames to export, 0 means until the application is closed (only with a window)
+    uint32_t    frame_count       = 0;
+    uint32_t    fps               = 60;
+    UVec2       render_size       = conf::win::window_size;
+    /// Signal to load at startup
+    std::string signal_path;
+    /// Number of coefficients to compute at startup
+    uint32_t    coefficient_count = 0;
+    /// Chrome trace written on exit, empty to disable
+    std::string trace_path;
+    /// Inputs file to write, empty to disable
+    std::string record_path;
+    /// Inputs file to replay instead of live inputs, empty to disable
+    std::string replay_path;
+    /// Headless runs fail if a frame allocates after this many frames, -1 to disable (needs PEZ_TRACK_ALLOCATIONS)
+    int32_t     allocation_check_frame = -1;
+
+    /// Returns false if the arguments are invalid, an error message is printed in this case
+    bool parse(int32_t argc, char** argv)
+    {
+        for (int32_t i{1}; i < argc; ++i) {
+            std::string const arg = argv[i];
+            // All options except --headless take a value
+            if (arg == "--headless") {
+                headless = true;
+                continue;
+            }
+            if (i + 1 >= argc) {
+                std::cout << "Missing value for " << arg << std::endl;
+                return false;
+            }
+            std::string const value = argv[++i];
+            if (arg == "--export") {
+                export_path = value;
+            } else if (arg == "--frames") {
+                frame_count = std::strtoul(value.c_str(), nullptr, 10);
+            } else if (arg == "--fps") {
+                fps = std::max(1ul, std::strtoul(value.c_str(), nullptr, 10));
+            } else if (arg == "--size") {
+                size_t const x = value.find('x');
+                if (x == std::string::npos) {
+                    std::cout << "Invalid size " << value << ", expected WIDTHxHEIGHT" << std::endl;
+                    return false;
+                }
+                render_size.x = std::strtoul(value.substr(0, x).c_str(), nullptr, 10);
+                render_size.y = std::strtoul(value.substr(x + 1).c_str(), nullptr, 10);
+            } else if (arg == "--signal") {
+                signal_path = value;
+            } else if (arg == "--coefficients") {
+                coefficient_count = std::strtoul(value.c_str(), nullptr, 10);
+            } else if (arg == "--trace") {
+                trace_path = value;
+            } else if (arg == "--record") {
+                record_path = value;
+            } else if (arg == "--replay") {
+                replay_path = value;
+            } else if (arg == "--check-allocations") {
+                allocation_check_frame = std::atoi(value.c_str());
+            } else {
+                std::cout << "Unknown option " << arg << std::endl;
+                return false;
+            }
+        }
+
+        if (headless && frame_count == 0 && replay_path.empty()) {
+            std::cout << "--frames or --replay is required in headless mode" << std::endl;
+            return false;
+        }
+        if (allocation_check_frame >= 0 && !(headless && pez::core::AllocationTracker::enabled)) {
+            std::cout << "--check-allocations requires --headless and a build with allocation tracking" << std::endl;
+            return false;
+        }
+        if (!record_path.empty() && !replay_path.empty()) {
+            std::cout << "--record and --replay cannot be used together" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    [[nodiscard]]
+    bool isExporting() const
+    {
+        return !export_path.empty();
+    }
+
+    /// PNG sequence unless the export path ends with .y4m
+    [[nodiscard]]
+    bool isVideoExport() const
+    {
+        std::string const extension = ".y4m";
+        return export_path.size() >= extension.size() &&
+               export_path.compare(export_path.size() - extension.size(), extension.size(), extension) == 0;
+    }
+};
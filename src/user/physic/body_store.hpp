@@ -0,0 +1,123 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "./configuration.hpp"
+
+
+namespace pbd
+{
+
+/** State of the solver's rigid bodies, stored as one array per component
+ *
+ *  The integration and velocity update of each substep go through all the bodies but only read a few components,
+ *  keeping each component contiguous lets these loops be vectorized. Bodies are accessed one by one through the
+ *  Object facade by the constraints. Bodies are never removed, so their index stays valid.
+ */
+struct BodyStore
+{
+    std::vector<RealType> position_x;
+    std::vector<RealType> position_y;
+    std::vector<RealType> position_last_x;
+    std::vector<RealType> position_last_y;
+    std::vector<RealType> velocity_x;
+    std::vector<RealType> velocity_y;
+    std::vector<RealType> angle;
+    std::vector<RealType> angle_last;
+    std::vector<RealType> angular_velocity;
+    std::vector<RealType> inv_mass;
+    std::vector<RealType> inv_inertia_tensor;
+    /// 1 for moving bodies and 0 for static ones, used as a factor to avoid branching in the kernels
+    std::vector<RealType> moving;
+    std::vector<RealType> center_of_mass_x;
+    std::vector<RealType> center_of_mass_y;
+
+    /// Rigid transform from object to world coordinates, world = rotation * local + translation
+    std::vector<RealType> rotation_cos;
+    std::vector<RealType> rotation_sin;
+    std::vector<RealType> translation_x;
+    std::vector<RealType> translation_y;
+
+    /// Adds a moving body at the origin and returns its index
+    uint32_t add()
+    {
+        auto const index = static_cast<uint32_t>(size());
+        for (std::vector<RealType>* component : {&position_x, &position_y, &position_last_x, &position_last_y,
+                                                 &velocity_x, &velocity_y, &angle, &angle_last, &angular_velocity,
+                                                 &center_of_mass_x, &center_of_mass_y, &rotation_sin,
+                                                 &translation_x, &translation_y}) {
+            component->push_back(0.0);
+        }
+        for (std::vector<RealType>* component : {&inv_mass, &inv_inertia_tensor, &moving, &rotation_cos}) {
+            component->push_back(1.0);
+        }
+        return index;
+    }
+
+    [[nodiscard]]
+    size_t size() const
+    {
+        return position_x.size();
+    }
+
+    /// Applies gravity and advances the positions and angles of the moving bodies by @p dt
+    void integrate(RealType dt, Vec2D gravity)
+    {
+        size_t const count = size();
+        integrateComponent(count, dt, gravity.x, position_x.data(), position_last_x.data(), velocity_x.data());
+        integrateComponent(count, dt, gravity.y, position_y.data(), position_last_y.data(), velocity_y.data());
+        integrateComponent(count, dt, 0.0, angle.data(), angle_last.data(), angular_velocity.data());
+        updateTransforms();
+    }
+
+    /// Deduces the velocities from the displacement of the substep
+    void updateVelocities(RealType dt, RealType friction)
+    {
+        size_t const   count = size();
+        RealType const keep  = 1.0 - friction;
+        updateVelocityComponent(count, dt, keep, position_x.data(), position_last_x.data(), velocity_x.data());
+        updateVelocityComponent(count, dt, keep, position_y.data(), position_last_y.data(), velocity_y.data());
+        updateVelocityComponent(count, dt, keep, angle.data(), angle_last.data(), angular_velocity.data());
+    }
+
+    /// Recomputes the transform of body @p i, to be called each time its position or angle change
+    void updateTransform(uint32_t i)
+    {
+        rotation_cos[i]  = std::cos(angle[i]);
+        rotation_sin[i]  = std::sin(angle[i]);
+        translation_x[i] = position_x[i] - (rotation_cos[i] * center_of_mass_x[i] - rotation_sin[i] * center_of_mass_y[i]);
+        translation_y[i] = position_y[i] - (rotation_sin[i] * center_of_mass_x[i] + rotation_cos[i] * center_of_mass_y[i]);
+    }
+
+    void updateTransforms()
+    {
+        for (uint32_t i{0}; i < size(); ++i) {
+            updateTransform(i);
+        }
+    }
+
+private:
+    /// Semi-implicit Euler step of one component, @p acceleration is only applied to moving bodies
+    void integrateComponent(size_t count, RealType dt, RealType acceleration,
+                            RealType* position, RealType* position_last, RealType* velocity) const
+    {
+        RealType const* const mask = moving.data();
+        for (size_t i{0}; i < count; ++i) {
+            velocity[i]      += dt * acceleration * mask[i];
+            position_last[i]  = position[i];
+            position[i]      += velocity[i] * dt * mask[i];
+        }
+    }
+
+    /// @p keep is the part of the velocity not lost to friction
+    static void updateVelocityComponent(size_t count, RealType dt, RealType keep,
+                                        RealType const* position, RealType const* position_last, RealType* velocity)
+    {
+        for (size_t i{0}; i < count; ++i) {
+            velocity[i] = (position[i] - position_last[i]) / dt * keep;
+        }
+    }
+};
+
+}
@@ -26,12 +26,12 @@ struct AngularConstraint
 
     void solve(RealType dt)
     {
-        Vec2D n_1 = {cos(o_1->angle), sin(o_1->angle)};
-        Vec2D n_2 = {cos(o_2->angle), sin(o_2->angle)};
+        Vec2D const n_1 = o_1->getDirection();
+        Vec2D const n_2 = o_2->getDirection();
 
         pbd::RealType const d_a = angle - MathVec2::angle(n_1, n_2);
-        pbd::RealType const w1 = o_1->inv_inertia_tensor;
-        pbd::RealType const w2 = o_2->inv_inertia_tensor;
+        pbd::RealType const w1 = o_1->getInvInertiaTensor();
+        pbd::RealType const w2 = o_2->getInvInertiaTensor();
         pbd::RealType const a            = constraint.compliance / (dt * dt);
         pbd::RealType const delta_lambda = (-d_a - a * constraint.lambda) / (w1 + w2 + a);
         constraint.lambda = delta_lambda;
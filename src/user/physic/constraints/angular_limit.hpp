@@ -29,8 +29,8 @@ struct AngularLimit
 
     void solve(RealType dt)
     {
-        RealType const a_1 = o_1->angle         ;
-        RealType const a_2 = o_2->angle - offset;
+        RealType const a_1 = o_1->getAngle()         ;
+        RealType const a_2 = o_2->getAngle() - offset;
         RealType const current = a_2 - a_1;
 
         RealType d_a = 0.0f;
@@ -40,8 +40,8 @@ struct AngularLimit
             d_a = angle_max - current;
         }
 
-        RealType const w1 = o_1->inv_inertia_tensor;
-        RealType const w2 = o_2->inv_inertia_tensor;
+        RealType const w1 = o_1->getInvInertiaTensor();
+        RealType const w2 = o_2->getInvInertiaTensor();
 
         RealType const a             = constraint.compliance / (dt * dt);
         RealType const delta_lambda  = (-d_a - a * constraint.lambda) / (w1 + w2 + a);
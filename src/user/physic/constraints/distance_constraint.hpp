@@ -30,8 +30,8 @@ struct DistanceConstraint
         Vec2 const anchor_1_world_position = anchor_1.obj->getWorldPosition(anchor_1.obj_coord);
         Vec2 const anchor_2_world_position = anchor_2.obj->getWorldPosition(anchor_2.obj_coord);
 
-        Vec2 const r1 = anchor_1_world_position - anchor_1.obj->position;
-        Vec2 const r2 = anchor_2_world_position - anchor_2.obj->position;
+        Vec2 const r1 = anchor_1_world_position - anchor_1.obj->getPosition();
+        Vec2 const r2 = anchor_2_world_position - anchor_2.obj->getPosition();
 
         Vec2  const v  = anchor_1_world_position - anchor_2_world_position;
         current_length = MathVec2::length(v);
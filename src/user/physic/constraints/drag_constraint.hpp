@@ -22,7 +22,7 @@ struct DragConstraint
     void solve(RealType dt)
     {
         Vec2D const pa = anchor.obj->getWorldPosition(anchor.obj_coord);
-        Vec2D const r1 = pa - anchor.obj->position;
+        Vec2D const r1 = pa - anchor.obj->getPosition();
 
         Vec2D const    v = (target - pa);
         RealType const d = MathVec2::length(v);
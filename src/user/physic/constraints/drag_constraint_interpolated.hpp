@@ -38,7 +38,7 @@ struct DragConstraintInterpolated
         }
 
         Vec2D const pa = anchor.obj->getWorldPosition(anchor.obj_coord);
-        Vec2D const r1 = pa - anchor.obj->position;
+        Vec2D const r1 = pa - anchor.obj->getPosition();
 
         Vec2D const    v = (target_current - pa);
         RealType const d = MathVec2::length(v);
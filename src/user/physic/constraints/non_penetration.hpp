@@ -33,8 +33,8 @@ struct NonPenetration
         Vec2  const n = v / d;
 
         Vec2 const contact = (p_1_world + p_2_world) * 0.5f;
-        Vec2 const r1      = contact - o_1->position;
-        Vec2 const r2      = contact - o_2->position;
+        Vec2 const r1      = contact - o_1->getPosition();
+        Vec2 const r2      = contact - o_2->getPosition();
 
         float const w1 = o_1->getGeneralizedInvMass(r1, n);
         float const w2 = o_2->getGeneralizedInvMass(r2, n);
@@ -25,8 +25,8 @@ struct ObjectPinConstraint
     {
         Vec2D const anchor_1_world_position = anchor_1.obj->getWorldPosition(anchor_1.obj_coord);
         Vec2D const anchor_2_world_position = anchor_2.obj->getWorldPosition(anchor_2.obj_coord);
-        Vec2D const r1 = anchor_1_world_position - anchor_1.obj->position;
-        Vec2D const r2 = anchor_2_world_position - anchor_2.obj->position;
+        Vec2D const r1 = anchor_1_world_position - anchor_1.obj->getPosition();
+        Vec2D const r2 = anchor_2_world_position - anchor_2.obj->getPosition();
 
         Vec2D const    v = anchor_1_world_position - anchor_2_world_position;
         RealType const d = MathVec2::length(v);
@@ -26,9 +26,9 @@ struct SegmentCollisionConstraint
 
     void solve(float dt)
     {
-        Vec2 const closest_point = MathVec2::closestSegmentPoint(obj->position, pt_1, pt_2);
+        Vec2 const closest_point = MathVec2::closestSegmentPoint(obj->getPosition(), pt_1, pt_2);
 
-        Vec2 const v = obj->position - closest_point;
+        Vec2 const v = obj->getPosition() - closest_point;
 
         float const dist_to_segment = MathVec2::length(v);
 
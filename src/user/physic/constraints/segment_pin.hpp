@@ -35,7 +35,7 @@ struct SegmentPinConstraint
 
         if (dist > 0.0) {
             Vec2D const n   = v / dist;
-            Vec2D const r_1 = pinned_pt_world - object_pinned->position;
+            Vec2D const r_1 = pinned_pt_world - object_pinned->getPosition();
             RealType const w_1 = object_pinned->getGeneralizedInvMass(r_1,  n);
             RealType const a            = constraint.compliance / (dt * dt);
             RealType const delta_lambda = dist / (w_1 + a);
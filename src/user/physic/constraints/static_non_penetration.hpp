@@ -23,7 +23,7 @@ struct StaticNonPenetration
 
     void solve(float dt)
     {
-        Vec2 const obj_pos = object->position;
+        Vec2 const obj_pos = object->getPosition();
         Vec2 const v = obj_pos - position;
 
         float const d = MathVec2::length(v);
@@ -36,8 +36,8 @@ struct SurfaceConstraint
     [[nodiscard]]
     float getOffset(Object const& object) const
     {
-        float const dist = MathVec2::distToLine(object.position, MathVec2::normal(normal), origin);
-        float const side = MathVec2::dot(object.position - origin, normal);
+        float const dist = MathVec2::distToLine(object.getPosition(), MathVec2::normal(normal), origin);
+        float const side = MathVec2::dot(object.getPosition() - origin, normal);
         if (side < 0.0f) { // The object is inside the surface
             return dist + 0.5f;
         } else { // The object is outside but overlap is still possible
@@ -1,42 +1,127 @@
 #pragma once
+#include "./configuration.hpp"
+#include "./body_store.hpp"
 #include "./vertex.hpp"
 #include "./matrix.hpp"
 
-#include <glm/glm.hpp>
-#include <glm/gtc/matrix_transform.hpp>
-
 #include "engine/common/math.hpp"
 
-#include <vector>
+#include <array>
+#include <cassert>
 
 
 namespace pbd
 {
 
+/// The particles of an object in its local space, stored inline since objects only have a few of them
+class Particles
+{
+public:
+    static constexpr uint32_t capacity = 4;
+
+    template<typename... TArgs>
+    Vec2D& emplace_back(TArgs&&... args)
+    {
+        assert(m_count < capacity && "Too many particles in object");
+        return m_data[m_count++] = Vec2D(std::forward<TArgs>(args)...);
+    }
+
+    [[nodiscard]]
+    uint32_t size() const
+    {
+        return m_count;
+    }
+
+    [[nodiscard]]
+    bool empty() const
+    {
+        return m_count == 0;
+    }
+
+    Vec2D& operator[](uint32_t i)
+    {
+        return m_data[i];
+    }
+
+    Vec2D const& operator[](uint32_t i) const
+    {
+        return m_data[i];
+    }
+
+    Vec2D const* begin() const
+    {
+        return m_data.data();
+    }
+
+    Vec2D const* end() const
+    {
+        return m_data.data() + m_count;
+    }
+
+private:
+    std::array<Vec2D, capacity> m_data  = {};
+    uint32_t                    m_count = 0;
+};
+
+/** A rigid body, its dynamic state lives in the solver's BodyStore
+ *
+ *  Only the data that does not change during the simulation is stored here, the position, angle and mass
+ *  properties are read and modified through the accessors.
+ */
 struct Object
 {
-    sf::Vector2<RealType> position      = {0.0, 0.0};
-    sf::Vector2<RealType> position_last = {0.0, 0.0};
-    RealType angle      = 0.0;
-    RealType angle_last = 0.0;
-    RealType density    = 1.0;
+    BodyStore* bodies = nullptr;
+    uint32_t   body   = 0;
 
-    sf::Vector2<RealType>  velocity;
-    RealType angular_velocity = 0.0f;
+    RealType  density = 1.0;
+    Particles particles;
+    sf::Color color   = sf::Color::White;
 
-    sf::Vector2<RealType> forces = {};
+    Object() = default;
 
-    sf::Vector2<RealType>  center_of_mass = {0.0, 0.0};
-    RealType inv_mass           = 1.0;
-    RealType inv_inertia_tensor = 1.0;
+    Object(BodyStore& bodies_, uint32_t body_)
+        : bodies{&bodies_}
+        , body{body_}
+    {}
 
-    std::vector<Vec2D> particles;
+    [[nodiscard]]
+    Vec2D getPosition() const
+    {
+        return {bodies->position_x[body], bodies->position_y[body]};
+    }
 
-    sf::Color color = sf::Color::White;
+    [[nodiscard]]
+    RealType getAngle() const
+    {
+        return bodies->angle[body];
+    }
+
+    [[nodiscard]]
+    Vec2D getCenterOfMass() const
+    {
+        return {bodies->center_of_mass_x[body], bodies->center_of_mass_y[body]};
+    }
+
+    [[nodiscard]]
+    RealType getInvMass() const
+    {
+        return bodies->inv_mass[body];
+    }
+
+    [[nodiscard]]
+    RealType getInvInertiaTensor() const
+    {
+        return bodies->inv_inertia_tensor[body];
+    }
 
-    bool moving = true;
+    /// Unit vector pointing in the direction of the object's angle
+    [[nodiscard]]
+    Vec2D getDirection() const
+    {
+        return {bodies->rotation_cos[body], bodies->rotation_sin[body]};
+    }
 
-    /// Computes inv_mass and inertia_tensor
+    /// Computes the center of mass, inv_mass and inertia_tensor
     void computeProperties()
     {
         // Compute center of mass
@@ -46,15 +131,26 @@ struct Object
             pos_sum += p;
             mass    += 1.0;
         }
-        center_of_mass = pos_sum / mass;
-        inv_mass       = 1.0 / (density * mass);
+        Vec2D const center_of_mass = pos_sum / mass;
+        bodies->center_of_mass_x[body] = center_of_mass.x;
+        bodies->center_of_mass_y[body] = center_of_mass.y;
+        bodies->inv_mass[body]         = 1.0 / (density * mass);
 
         // Compute inertia_tensor
         RealType inertia_tensor = 0.0;
         for (auto const& p : particles) {
             inertia_tensor += (1.0 + MathVec2::length2(p - center_of_mass)) * density;
         }
-        inv_inertia_tensor = 1.0 / inertia_tensor;
+        bodies->inv_inertia_tensor[body] = 1.0 / inertia_tensor;
+        bodies->updateTransform(body);
+    }
+
+    /// The object is not moved by gravity nor by constraints anymore
+    void makeStatic()
+    {
+        bodies->moving[body]             = 0.0;
+        bodies->inv_mass[body]           = 0.0;
+        bodies->inv_inertia_tensor[body] = 0.0;
     }
 
     /**
@@ -67,50 +163,37 @@ struct Object
     RealType getGeneralizedInvMass(Vec2D r, Vec2D n) const
     {
         RealType const cross_product = MathVec2::cross(r, n);
-        return inv_mass + cross_product * inv_inertia_tensor * cross_product;
+        return getInvMass() + cross_product * getInvInertiaTensor() * cross_product;
     }
 
-    void update(RealType dt)
-    {
-        if (!moving) {
-            return;
-        }
-        // Linear update
-        position_last = position;
-        velocity = velocity + dt * forces * inv_mass;
-        position = position + velocity * dt;
-        // Angular update
-        angle_last = angle;
-        // Not sure about this at all
-        angle = angle + angular_velocity * dt;
-    }
-
-    void updateVelocities(RealType dt, RealType friction)
+    void applyPositionCorrection(Vec2D p, Vec2D r)
     {
-        velocity         = (position - position_last) / dt * (1.0 - friction);
-        angular_velocity = (angle - angle_last)       / dt * (1.0 - friction);
+        RealType const inv_mass = getInvMass();
+        bodies->position_x[body] += p.x * inv_mass;
+        bodies->position_y[body] += p.y * inv_mass;
+        bodies->angle[body]      += MathVec2::cross(r, p) * getInvInertiaTensor();
+        bodies->updateTransform(body);
     }
 
-    void applyPositionCorrection(Vec2D p, Vec2D r)
+    void applyRotationCorrection(RealType a)
     {
-        position += p * inv_mass;
-        angle    += MathVec2::cross(r, p) * inv_inertia_tensor;
+        bodies->angle[body] += a * getInvInertiaTensor();
+        bodies->updateTransform(body);
     }
 
-    void applyRotationCorrection(RealType a)
+    /// Rotates @p v by the object's angle
+    [[nodiscard]]
+    Vec2D rotate(Vec2D v) const
     {
-        angle += a * inv_inertia_tensor;
+        RealType const c = bodies->rotation_cos[body];
+        RealType const s = bodies->rotation_sin[body];
+        return {c * v.x - s * v.y, s * v.x + c * v.y};
     }
 
     [[nodiscard]]
     Vec2D getWorldPosition(Vec2D obj_coord) const
     {
-        glm::mat<4, 4, RealType> transform(1.0);
-        transform = glm::translate(transform, {position.x, position.y, 0.0});
-        transform = glm::rotate(transform, angle, {0.0, 0.0, 1.0});
-        transform = glm::translate(transform, {-center_of_mass.x, -center_of_mass.y, 0.0});
-        glm::vec<4, RealType> const result = transform * glm::vec4{obj_coord.x, obj_coord.y, 0.0, 1.0};
-        return {result.x, result.y};
+        return rotate(obj_coord) + Vec2D{bodies->translation_x[body], bodies->translation_y[body]};
     }
 
     [[nodiscard]]
@@ -122,18 +205,20 @@ struct Object
     [[nodiscard]]
     Vec2D getObjectPosition(Vec2D world_coord) const
     {
-        glm::mat<4, 4, RealType> transform(1.0);
-        transform = glm::translate(transform, {center_of_mass.x, center_of_mass.y, 0.0});
-        transform = glm::rotate(transform, -angle, {0.0, 0.0, 1.0});
-        transform = glm::translate(transform, {-position.x, -position.y, 0.0});
-        glm::vec<4, RealType> const result = transform * glm::vec4{world_coord.x, world_coord.y, 0.0, 1.0};
-        return {result.x, result.y};
+        // The inverse rotation is the transposed one
+        RealType const c = bodies->rotation_cos[body];
+        RealType const s = bodies->rotation_sin[body];
+        Vec2D const    v = world_coord - getPosition();
+        return Vec2D{c * v.x + s * v.y, -s * v.x + c * v.y} + getCenterOfMass();
     }
 
     void setPositionInstant(Vec2D new_position)
     {
-        position      = new_position;
-        position_last = new_position;
+        bodies->position_x[body]      = new_position.x;
+        bodies->position_y[body]      = new_position.y;
+        bodies->position_last_x[body] = new_position.x;
+        bodies->position_last_y[body] = new_position.y;
+        bodies->updateTransform(body);
     }
 };
 
@@ -1,9 +1,11 @@
 #pragma once
 #include "engine/common/index_vector.hpp"
 #include "engine/common/utils.hpp"
+#include "engine/core/profiler.hpp"
 
 #include "./configuration.hpp"
 #include "./constraints/constraint.hpp"
+#include "./body_store.hpp"
 #include "./object.hpp"
 #include "./complex.hpp"
 
@@ -19,6 +21,8 @@ namespace pbd
 
 struct Solver
 {
+    /// Dynamic state of the objects, the objects themselves are facades over it
+    BodyStore                bodies;
     siv::IndexVector<Object> objects;
 
     siv::IndexVector<DragConstraintInterpolated> drag_constraints;
@@ -34,14 +38,12 @@ struct Solver
 
     void update(RealType dt)
     {
+        PEZ_PROFILE_SCOPE("Solver::update");
         uint32_t const pos_iter{1};
         RealType const sub_dt{dt / to<RealType>(sub_steps)};
 
         for (uint32_t i{sub_steps}; i--;) {
-            for (auto &obj: objects) {
-                obj.forces = gravity / obj.inv_mass;
-                obj.update(sub_dt);
-            }
+            bodies.integrate(sub_dt, gravity);
 
             resetConstraints();
 
@@ -51,10 +53,7 @@ struct Solver
                 solveConstraintsReverse(sub_dt);
             }
 
-
-            for (auto& obj: objects) {
-                obj.updateVelocities(sub_dt, friction);
-            }
+            bodies.updateVelocities(sub_dt, friction);
         }
     }
 
@@ -132,7 +131,7 @@ struct Solver
 
     siv::Ref<Object> createObject()
     {
-        siv::ID const id = objects.emplace_back();
+        siv::ID const id = objects.emplace_back(bodies, bodies.add());
         return objects.createRef(id);
     }
 
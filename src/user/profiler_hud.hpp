@@ -0,0 +1,128 @@
+#pragma once
+#include <cstdio>
+#include <SFML/Graphics.hpp>
+
+#include "engine/engine.hpp"
+#include "engine/common/utils.hpp"
+#include "engine/common/chart/bar_graph.hpp"
+#include "engine/common/chart/line_chart.hpp"
+
+
+/** Displays the profiler's zones and the render stats in the top right corner of the screen
+ *
+ *  The line chart shows the duration of the last frames, bars and text show the mean time spent in each zone.
+ *  The render stats and culling counters are those of the last displayed frame.
+ *  Zones are only recorded when built with PEZ_PROFILING.
+ */
+struct ProfilerHUD : public pez::core::IRenderer
+{
+    static constexpr float width  = 640.0f;
+    static constexpr float margin = 20.0f;
+
+    bool draw = false;
+
+    sf::Text  text;
+    LineChart frame_chart;
+    BarGraph  zones_graph;
+
+    std::string lines;
+
+    ProfilerHUD()
+        : frame_chart{{width, 80.0f}}
+        , zones_graph{{width, 60.0f}}
+    {
+        text.setFont(pez::resources::getFont("font"));
+        text.setFillColor(sf::Color::White);
+        text.setCharacterSize(16);
+
+        frame_chart.setColor({42, 157, 143});
+        frame_chart.line_thickness = 1.0f;
+        zones_graph.setColor({231, 111, 81});
+    }
+
+    void toggle()
+    {
+        draw = !draw;
+        frame_chart.clear();
+    }
+
+    void render(pez::render::Context& context) override
+    {
+        if (!draw) {
+            return;
+        }
+        pez::render::Context::StatsTag const stats_tag{context, "HUD"};
+
+        auto& profiler = pez::core::Profiler::get();
+        Vec2 const position = {to<float>(context.getRenderSize().x) - width - margin, margin};
+
+        // Frame durations
+        frame_chart.position = position;
+        frame_chart.addValue(profiler.getFrameHistory().getValue(-1));
+        if (frame_chart.values.getCount() > 1) {
+            context.drawDirect(frame_chart.va_area, sf::Transform::Identity);
+            context.drawDirect(frame_chart.va_line, sf::Transform::Identity);
+        }
+
+        // Zones, indented by depth
+        char buffer[128];
+        std::snprintf(buffer, sizeof(buffer), "Frame %6.2f ms", profiler.getFrameTime());
+        lines = buffer;
+        if constexpr (pez::core::AllocationTracker::enabled) {
+            auto const allocations = pez::core::AllocationTracker::getLastFrame();
+            std::snprintf(buffer, sizeof(buffer), "  %llu allocations %llu KB",
+                          static_cast<unsigned long long>(allocations.count),
+                          static_cast<unsigned long long>(allocations.bytes / 1024));
+            lines += buffer;
+        }
+        lines += '\n';
+        zones_graph.clear();
+        profiler.foreach([&](pez::core::Profiler::Zone const& zone) {
+            std::snprintf(buffer, sizeof(buffer), "%*s%-28s %6.2f ms  x%u",
+                          2 * zone.depth, "", zone.name.c_str(), zone.getMean(), zone.calls);
+            lines += buffer;
+            if constexpr (pez::core::AllocationTracker::enabled) {
+                std::snprintf(buffer, sizeof(buffer), "  %llu allocs", static_cast<unsigned long long>(zone.allocations));
+                lines += buffer;
+            }
+            lines += '\n';
+            zones_graph.addValue(zone.getMean());
+        });
+
+        std::snprintf(buffer, sizeof(buffer), "Task start latency %6.1f us\n",
+                      pez::core::getSingleton<tp::ThreadPool>().getStartLatency());
+        lines += buffer;
+        pez::core::FrameArena const& arena = pez::core::FrameArena::get();
+        std::snprintf(buffer, sizeof(buffer), "Frame arena %6zu KB  peak %6zu KB\n",
+                      arena.getUsed() / 1024, arena.getPeak() / 1024);
+        lines += buffer;
+
+        // Render stats of the last frame
+        auto const addStatsLine = [&](char const* name, pez::render::RenderStats::Counters const& counters) {
+            std::snprintf(buffer, sizeof(buffer), "%-12s %5u draws %7llu vertices %5u transforms %4u binds\n",
+                          name, counters.draw_calls, static_cast<unsigned long long>(counters.vertices),
+                          counters.transforms, counters.texture_binds);
+            lines += buffer;
+        };
+        pez::render::RenderStats const& stats = context.getRenderStats();
+        lines += '\n';
+        addStatsLine("Total", stats.total);
+        stats.foreachTag([&](char const* name, pez::render::RenderStats::Counters const& counters) {
+            addStatsLine(name, counters);
+        });
+        pez::render::Context::CullingStats const& culling = context.getCullingStats();
+        std::snprintf(buffer, sizeof(buffer), "Culling      %5u submitted %5u culled %7llu clipped vertices %4u unsupported\n",
+                      culling.submitted, culling.culled, static_cast<unsigned long long>(culling.clipped_vertices),
+                      culling.unsupported);
+        lines += buffer;
+
+        zones_graph.setPosition(position + Vec2{0.0f, frame_chart.size.y + margin});
+        if (zones_graph.extremes.y > 0.0f) {
+            zones_graph.draw(context);
+        }
+
+        text.setString(lines);
+        text.setPosition(position + Vec2{0.0f, frame_chart.size.y + zones_graph.size.y + 2.0f * margin});
+        context.drawDirect(text);
+    }
+};
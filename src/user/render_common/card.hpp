@@ -67,9 +67,9 @@ struct Card
         sf::Transform transform;
         transform.translate(position);
         if (shadow_size > 0.0f) {
-            context.draw(va_shadow, transform);
+            context.drawCulled(va_shadow, {-shadow_size, -shadow_size, size.x + 2.0f * shadow_size, size.y + 2.0f * shadow_size}, transform);
         }
-        context.draw(va, transform);
+        context.drawCulled(va, {{}, size}, transform);
     }
 
     void setWidth(float width)
@@ -60,7 +60,7 @@ struct EmptyCard
     {
         sf::Transform transform;
         transform.translate(position);
-        context.draw(va, transform);
+        context.drawCulled(va, {-thickness, -thickness, size.x + 2.0f * thickness, size.y + 2.0f * thickness}, transform);
     }
 
     void setWidth(float width)
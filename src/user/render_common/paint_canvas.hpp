@@ -0,0 +1,200 @@
+#pragma once
+#include <memory>
+#include "engine/engine.hpp"
+
+
+/** A CPU side accumulation image the settled part of a stroke is burned into
+ *
+ *  The canvas covers a rectangle of the world and is split into square tiles that are only allocated once
+ *  something is painted on them. Coverage is stored per texel and combined with max, this way overlapping
+ *  segments of a stroke do not darken joints. Only tiles modified since last render are uploaded to their texture.
+ *  When the context renders with the software rasterizer, tiles are uploaded to an image the rasterizer samples
+ *  instead and their texture is never created, so no GPU is needed.
+ */
+struct PaintCanvas
+{
+    /// Size in texels of a tile side
+    static constexpr uint32_t tile_size = 256;
+
+    struct Tile
+    {
+        std::vector<uint8_t>    coverage;
+        std::vector<sf::Uint8>  pixels;
+        sf::Texture             texture;
+        /// CPU copy of the pixels for the software rasterizer
+        sf::Image               image;
+        sf::Sprite              sprite;
+        bool                    dirty = false;
+        /// True if something has been painted since last clear
+        bool                    used  = false;
+        /// True once the texture or the image has been set up, on first upload
+        bool                    ready = false;
+
+        Tile()
+            : coverage(tile_size * tile_size, 0)
+            , pixels(4 * tile_size * tile_size, 0)
+        {
+            // The rect is explicit since the texture may never be created
+            sprite.setTexture(texture);
+            sprite.setTextureRect({0, 0, to<int32_t>(tile_size), to<int32_t>(tile_size)});
+        }
+    };
+
+    sf::Color color = sf::Color::White;
+    /// World position of the top left corner
+    Vec2      origin;
+    /// Number of texels per world unit
+    float     scale;
+    int32_t   tiles_x;
+    int32_t   tiles_y;
+    std::vector<std::unique_ptr<Tile>> tiles;
+
+    PaintCanvas(Vec2 origin_, Vec2 size, float scale_)
+        : origin{origin_}
+        , scale{scale_}
+        , tiles_x{to<int32_t>(std::ceil(size.x * scale / to<float>(tile_size)))}
+        , tiles_y{to<int32_t>(std::ceil(size.y * scale / to<float>(tile_size)))}
+    {
+        tiles.resize(tiles_x * tiles_y);
+    }
+
+    void setColor(sf::Color c)
+    {
+        color = c;
+        for (auto& tile : tiles) {
+            if (tile) {
+                tile->dirty = tile->used;
+            }
+        }
+    }
+
+    /// Erases the canvas, allocated tiles are kept for reuse
+    void clear()
+    {
+        for (auto& tile : tiles) {
+            if (tile && tile->used) {
+                std::fill(tile->coverage.begin(), tile->coverage.end(), 0);
+                tile->used  = false;
+                tile->dirty = false;
+            }
+        }
+    }
+
+    /** Paints a segment with round caps and a radius linearly interpolated along it
+     *
+     * @param p0 The start of the segment, in world coordinates
+     * @param p1 The end of the segment
+     * @param r0 The radius at @p p0
+     * @param r1 The radius at @p p1
+     */
+    void addSegment(Vec2 p0, Vec2 p1, float r0, float r1)
+    {
+        if (r0 <= 0.0f && r1 <= 0.0f) {
+            return;
+        }
+        // Work in texel space
+        p0 = (p0 - origin) * scale;
+        p1 = (p1 - origin) * scale;
+        r0 *= scale;
+        r1 *= scale;
+
+        float const r_max = std::max(r0, r1) + 1.0f;
+        int32_t const x_min = std::max(to<int32_t>(std::floor(std::min(p0.x, p1.x) - r_max)), 0);
+        int32_t const y_min = std::max(to<int32_t>(std::floor(std::min(p0.y, p1.y) - r_max)), 0);
+        int32_t const x_max = std::min(to<int32_t>(std::ceil(std::max(p0.x, p1.x) + r_max)), tiles_x * to<int32_t>(tile_size) - 1);
+        int32_t const y_max = std::min(to<int32_t>(std::ceil(std::max(p0.y, p1.y) + r_max)), tiles_y * to<int32_t>(tile_size) - 1);
+        // Entirely outside of the canvas, integer division would round the negative bounds toward the first tile
+        if (x_min > x_max || y_min > y_max) {
+            return;
+        }
+
+        Vec2 const  d      = p1 - p0;
+        float const length = MathVec2::length(d);
+        Vec2 const  dir    = (length > 0.0f) ? d / length : Vec2{};
+
+        // Process the bounding box tile by tile
+        auto const ts = to<int32_t>(tile_size);
+        for (int32_t ty{y_min / ts}; ty <= y_max / ts; ++ty) {
+            for (int32_t tx{x_min / ts}; tx <= x_max / ts; ++tx) {
+                Tile& tile = getTile(tx, ty);
+                int32_t const x_start = std::max(x_min, tx * ts);
+                int32_t const x_end   = std::min(x_max, tx * ts + ts - 1);
+                int32_t const y_start = std::max(y_min, ty * ts);
+                int32_t const y_end   = std::min(y_max, ty * ts + ts - 1);
+                bool modified = false;
+                for (int32_t y{y_start}; y <= y_end; ++y) {
+                    for (int32_t x{x_start}; x <= x_end; ++x) {
+                        Vec2 const  v     = Vec2{to<float>(x) + 0.5f, to<float>(y) + 0.5f} - p0;
+                        float const along = std::min(std::max(MathVec2::dot(v, dir), 0.0f), length);
+                        float const t     = (length > 0.0f) ? along / length : 0.0f;
+                        float const dist  = MathVec2::length(v - along * dir);
+                        float const r     = r0 + (r1 - r0) * t;
+                        // One texel wide linear falloff for anti aliasing
+                        float const alpha = std::min(std::max(r - dist + 0.5f, 0.0f), 1.0f);
+                        auto const  value = to<uint8_t>(alpha * 255.0f);
+                        uint8_t&    texel = tile.coverage[(y - ty * ts) * ts + (x - tx * ts)];
+                        if (value > texel) {
+                            texel    = value;
+                            modified = true;
+                        }
+                    }
+                }
+                tile.dirty = tile.dirty || modified;
+                tile.used  = tile.used || modified;
+            }
+        }
+    }
+
+    void render(pez::render::Context& context)
+    {
+        context.beginLayer();
+        for (auto& tile : tiles) {
+            if (!tile || !tile->used) {
+                continue;
+            }
+            if (tile->dirty) {
+                upload(*tile, context);
+            }
+            context.drawCulled(tile->sprite, tile->sprite.getGlobalBounds());
+        }
+        context.endLayer();
+    }
+
+private:
+    Tile& getTile(int32_t x, int32_t y)
+    {
+        auto& tile = tiles[y * tiles_x + x];
+        if (!tile) {
+            tile = std::make_unique<Tile>();
+            float const tile_world_size = to<float>(tile_size) / scale;
+            tile->sprite.setPosition(origin + Vec2{to<float>(x), to<float>(y)} * tile_world_size);
+            tile->sprite.setScale(1.0f / scale, 1.0f / scale);
+        }
+        return *tile;
+    }
+
+    void upload(Tile& tile, pez::render::Context& context)
+    {
+        for (uint32_t i{0}; i < tile_size * tile_size; ++i) {
+            tile.pixels[4 * i + 0] = color.r;
+            tile.pixels[4 * i + 1] = color.g;
+            tile.pixels[4 * i + 2] = color.b;
+            tile.pixels[4 * i + 3] = to<sf::Uint8>((tile.coverage[i] * color.a) / 255);
+        }
+        if (context.getRasterizer()) {
+            // Same size every time, the image keeps its storage
+            tile.image.create(tile_size, tile_size, tile.pixels.data());
+            if (!tile.ready) {
+                context.addTextureImage(tile.texture, tile.image);
+            }
+        } else {
+            if (!tile.ready) {
+                tile.texture.create(tile_size, tile_size);
+                tile.texture.setSmooth(true);
+            }
+            tile.texture.update(tile.pixels.data());
+        }
+        tile.ready = true;
+        tile.dirty = false;
+    }
+};
@@ -1,83 +1,473 @@
 #pragma once
+#include <algorithm>
+#include <array>
+#include <cstring>
 #include "engine/engine.hpp"
-#include "engine/common/smooth/smooth_value.hpp"
+#include "engine/common/smooth/smooth.hpp"
+#include "./paint_canvas.hpp"
 
 
+/** Draws a trail following the last @p capacity points it has been given.
+ *
+ *  Only the points and their birth times are stored, in a ring buffer. The triangle strip is generated at render
+ *  time from them, by chunks of @p chunk_size points written into a small scratch array, so that the memory per
+ *  point does not include any vertex.
+ *
+ *  A point's width only depends on its age, it is evaluated from the point's birth time and a precomputed
+ *  table of the easing function instead of storing an animated value per point.
+ *
+ *  Settled points are also added to coarser levels of the polyline, keeping one point every 2^k. At render time
+ *  the coarsest level whose deviation from the full polyline stays below @p decimation_tolerance pixels is used
+ *  for the settled part, only the animated tail is drawn at full resolution.
+ *
+ *  Alternatively, settled segments can be burned into a PaintCanvas, in this case only the animated tail is kept
+ *  as geometry and the tracer capacity can be kept small.
+ */
 struct Tracer
 {
-    sf::Color                color = sf::Color::White;
-    std::vector<Vec2>        points;
-    std::vector<SmoothFloat> width;
-    std::vector<uint32_t>    draw;
-    sf::VertexArray          va_line;
+    /** A coarser version of the polyline keeping one point every @p step
+     *
+     *  Entry j corresponds to the point j * step, it is only added once its point has settled. The points are read
+     *  from the ring buffer of the tracer, a level only stores the error of each entry.
+     */
+    struct Level
+    {
+        uint64_t              step     = 1;
+        uint64_t              capacity = 0;
+        /// Maximum distance between the segment ending at an entry and the points it replaces, see packError
+        std::vector<uint16_t> errors;
+        /// Index of the next entry
+        uint64_t              count       = 0;
+        /// Index of the first entry connected to the previous entry
+        uint64_t              first_valid = 0;
+
+        void initialize(uint64_t step_, uint64_t capacity_)
+        {
+            step     = step_;
+            capacity = capacity_;
+            errors.resize(capacity);
+            clear();
+        }
+
+        void clear()
+        {
+            count       = 0;
+            first_valid = 0;
+        }
+
+        /// Adds entry @p j
+        void add(uint64_t j, float error)
+        {
+            // Missing entries break the strip
+            if (j != count) {
+                first_valid = j;
+            }
+            count = j + 1;
+            errors[j % capacity] = packError(error);
+        }
+
+        /// Entry @p j cannot be connected to its previous entry, the strip restarts after it
+        void skip(uint64_t j)
+        {
+            count       = j + 1;
+            first_valid = count;
+        }
+
+        /// Returns the first entry that can be drawn when the oldest point of the tracer is @p first_point
+        [[nodiscard]]
+        uint64_t getFirstDrawn(uint64_t first_point) const
+        {
+            uint64_t const first_connected = (first_point + step - 1) / step + 1;
+            uint64_t const first_stored    = count > capacity ? count - capacity : 0;
+            return std::max({first_valid, first_connected, first_stored});
+        }
+
+        /// Returns the maximum error of entries from @p first
+        [[nodiscard]]
+        float getMaxError(uint64_t first) const
+        {
+            // Packed errors keep the order of the floats
+            uint16_t max_error = 0;
+            for (uint64_t j{first}; j < count; ++j) {
+                max_error = std::max(max_error, errors[j % capacity]);
+            }
+            return unpackError(max_error);
+        }
+
+        /// Keeps the upper 16 bits of the error, rounded up so that the tolerance is never exceeded
+        [[nodiscard]]
+        static uint16_t packError(float error)
+        {
+            uint32_t bits = 0;
+            std::memcpy(&bits, &error, sizeof(bits));
+            // Rounding up saturates to the largest finite float
+            return static_cast<uint16_t>(std::min<uint32_t>(bits + 0xFFFF, 0x7F7FFFFF) >> 16);
+        }
+
+        [[nodiscard]]
+        static float unpackError(uint16_t packed)
+        {
+            uint32_t const bits = static_cast<uint32_t>(packed) << 16;
+            float error = 0.0f;
+            std::memcpy(&error, &bits, sizeof(error));
+            return error;
+        }
+    };
+
+
+    /// Birth time of points that are not drawn, their width is always 0
+    static constexpr float not_drawn = -1.0f;
+    /// Resolution of the width table
+    static constexpr uint32_t width_table_size = 256;
+    /// Maximum number of coarse levels, the coarsest one keeps one point every 2^max_level_count
+    static constexpr uint32_t max_level_count = 8;
+    /// Number of points whose vertices are generated at once when drawing
+    static constexpr uint64_t chunk_size = 256;
+
+    sf::Color          color = sf::Color::White;
+    std::vector<Vec2>  points;
+    std::vector<float> birth;
+    /// Scratch buffer holding the vertices of the chunk being drawn
+    std::vector<sf::Vertex> vertices;
+    sf::CircleShape    tip;
+    std::vector<Level> levels;
+    /// Maximum deviation in pixels allowed when drawing a coarse level
+    float decimation_tolerance = 0.25f;
+    /// If set, settled segments are painted on it instead of being kept as geometry
+    PaintCanvas* canvas = nullptr;
 
     float width_start = 4.0f;
     float width_end   = 0.0f;
     float width_speed = 0.0f;
     Interpolation interpolation = Interpolation::EaseInOutQuint;
+    /// Width as a function of the normalized age, the last entry being the final width
+    std::array<float, width_table_size + 1> width_table = {};
+
+    /// The maximum number of points kept
+    uint32_t capacity = 0;
+    /// Total number of points added since last clear, the last point is at index points_count - 1
+    uint64_t points_count = 0;
+    /// Index of the oldest point whose width may still be changing
+    uint64_t first_animated = 0;
 
     explicit
-    Tracer()
-        : va_line{sf::PrimitiveType::TriangleStrip}
-    {}
+    Tracer(uint32_t capacity_ = 4096)
+        : vertices(2 * chunk_size)
+    {
+        setCapacity(capacity_);
+        updateWidthTable();
+    }
+
+    /** Sets how the width of drawn points evolves
+     *
+     * @param start The width of a new point
+     * @param end The final width
+     * @param speed The inverse of the transition duration in seconds, 0 means the width stays at @p start
+     * @param interpolation_ The easing function of the transition
+     */
+    void setWidth(float start, float end, float speed, Interpolation interpolation_)
+    {
+        width_start   = start;
+        width_end     = end;
+        width_speed   = speed;
+        interpolation = interpolation_;
+        updateWidthTable();
+    }
 
     void setColor(sf::Color c)
     {
         color = c;
+        if (canvas) {
+            canvas->setColor(c);
+        }
     }
 
-    void clear()
+    /// Sets the canvas settled segments are painted on, nullptr to keep them as geometry
+    void setCanvas(PaintCanvas* canvas_)
     {
-        points.clear();
-        width.clear();
+        canvas = canvas_;
+        if (!canvas) {
+            return;
+        }
+        canvas->setColor(color);
+        // Paint the points that already settled
+        float const now = pez::core::getTime();
+        for (uint64_t i{getFirstDrawablePoint()}; i < first_animated; ++i) {
+            paintSegment(i, now);
+        }
     }
 
-    void addPoint(Vec2 pt, bool draw_)
+    /// Changes the maximum number of points, the most recent points are kept
+    void setCapacity(uint32_t new_capacity)
     {
-        points.push_back(pt);
+        new_capacity = std::max(new_capacity, 2u);
+        if (new_capacity == capacity) {
+            return;
+        }
 
-        auto& w = width.emplace_back();
-        w.setValueInstant(draw_ ? width_start : 0.0f);
-        w.setInterpolationFunction(interpolation);
-        w.setSpeed(width_speed);
-        if (draw_) {
-            w = width_end;
+        // Save the points that will be kept
+        uint64_t const kept_count = std::min<uint64_t>(getSize(), new_capacity);
+        std::vector<Vec2>  kept_points;
+        std::vector<float> kept_birth;
+        kept_points.reserve(kept_count);
+        kept_birth.reserve(kept_count);
+        for (uint64_t i{points_count - kept_count}; i < points_count; ++i) {
+            kept_points.push_back(points[getSlot(i)]);
+            kept_birth.push_back(birth[getSlot(i)]);
+        }
+
+        capacity = new_capacity;
+        points.resize(capacity);
+        birth.resize(capacity);
+        // Coarse levels are only useful if they keep a significant number of points
+        levels.clear();
+        for (uint64_t step{2}; step <= capacity / 8 && levels.size() < max_level_count; step *= 2) {
+            levels.emplace_back().initialize(step, capacity / step + 2);
+        }
+        reset();
+
+        for (uint64_t i{0}; i < kept_count; ++i) {
+            push(kept_points[i], kept_birth[i]);
         }
     }
 
+    /// Removes all points and erases the canvas
+    void clear()
+    {
+        reset();
+        if (canvas) {
+            canvas->clear();
+        }
+    }
+
+    /// Removes all points, the canvas is left untouched
+    void reset()
+    {
+        points_count   = 0;
+        first_animated = 0;
+        for (Level& level : levels) {
+            level.clear();
+        }
+    }
+
+    /// Number of points currently stored
+    [[nodiscard]]
+    uint64_t getSize() const
+    {
+        return std::min<uint64_t>(points_count, capacity);
+    }
+
+    void addPoint(Vec2 pt, bool draw_)
+    {
+        push(pt, draw_ ? pez::core::getTime() : not_drawn);
+    }
+
     void render(pez::render::Context& context)
     {
-        if (points.empty()) {
+        PEZ_PROFILE_SCOPE("Tracer::render");
+        pez::render::Context::StatsTag const stats_tag{context, "Tracer"};
+        if (points_count == 0) {
             return;
         }
 
-        va_line.resize(2 * points.size() - 2);
-
-        if (points.size() > 1) {
-            Vec2 last = points[0];
-            uint32_t i{0};
-            for (auto const& pt: points) {
-                if (i > 0) {
-                    Vec2 const current = pt;
-                    Vec2 const d = current - last;
-                    Vec2 const n = MathVec2::normalize(MathVec2::normal(d));
-                    float const w = width[i].get();
-                    va_line[2 * (i - 1) + 0].position = current + w * n;
-                    va_line[2 * (i - 1) + 1].position = current - w * n;
-                    va_line[2 * (i - 1) + 0].color = color;
-                    va_line[2 * (i - 1) + 1].color = color;
-                    last = current;
-                }
-                ++i;
-            }
-            context.draw(va_line);
+        float const now = pez::core::getTime();
+        advanceSettled(now);
+
+        // The settled part is drawn with the canvas or the coarsest acceptable level, the rest at full resolution
+        uint64_t first_point = getFirstDrawablePoint();
+        if (canvas) {
+            canvas->render(context);
+            // The last painted point is needed to connect the strip
+            first_point = std::max(first_point, first_animated ? first_animated - 1 : 0);
+        } else if (Level* level = selectLevel(context.getZoom())) {
+            uint64_t const first_entry = level->getFirstDrawn(points_count - getSize());
+            drawStrip(context, first_entry * level->step, level->count - first_entry, level->step, now);
+            first_point = (level->count - 1) * level->step;
+        }
+        if (first_point < points_count) {
+            drawStrip(context, first_point, points_count - first_point, 1, now);
         }
 
-        float const radius{width.back().get()};
-        sf::CircleShape tip{radius};
+        float const radius{getWidth(birth[getSlot(points_count - 1)], now)};
+        tip.setRadius(radius);
         tip.setOrigin(radius, radius);
-        tip.setPosition(points.back());
+        tip.setPosition(points[getSlot(points_count - 1)]);
         tip.setFillColor(color);
-        context.draw(tip);
+        context.drawCulled(tip, tip.getGlobalBounds());
+    }
+
+private:
+    /** Draws the strip going through @p count points, the point k being first + k * @p step
+     *
+     *  The vertices are generated by chunks, consecutive chunks share a point so that the segment joining them is
+     *  drawn. The point before @p first has to be stored since it gives the direction of the first point.
+     */
+    void drawStrip(pez::render::Context& context, uint64_t first, uint64_t count, uint64_t step, float now)
+    {
+        uint64_t k = 0;
+        // A single point left has no segment of its own
+        while (k + 1 < count) {
+            uint64_t const end = std::min(k + chunk_size, count);
+            sf::Vertex*    out = vertices.data();
+            for (uint64_t c{k}; c < end; ++c) {
+                uint64_t const i      = first + c * step;
+                Vec2 const     pt     = points[getSlot(i)];
+                Vec2 const     offset = getOffset(i, step, now);
+                *(out++) = sf::Vertex{pt + offset, color};
+                *(out++) = sf::Vertex{pt - offset, color};
+            }
+            // The command buffer copies the vertices, the scratch can be reused by the next chunk
+            context.drawClipped(vertices.data(), 2 * (end - k), sf::PrimitiveType::TriangleStrip);
+            k = end - 1;
+        }
+    }
+
+    /// Half width vector of point @p i, perpendicular to the segment coming from point i - @p step
+    [[nodiscard]]
+    Vec2 getOffset(uint64_t i, uint64_t step, float now) const
+    {
+        Vec2 const  d      = points[getSlot(i)] - points[getSlot(i - step)];
+        float const length = MathVec2::length(d);
+        Vec2 const  n      = (length > 0.0f) ? MathVec2::normal(d) / length : Vec2{};
+        return getWidth(birth[getSlot(i)], now) * n;
+    }
+
+    [[nodiscard]]
+    uint64_t getSlot(uint64_t i) const
+    {
+        return i % capacity;
+    }
+
+    /// The first point of the buffer cannot be drawn since its previous point is needed to compute its direction
+    [[nodiscard]]
+    uint64_t getFirstDrawablePoint() const
+    {
+        return std::max<uint64_t>(points_count - getSize(), 1);
+    }
+
+    void updateWidthTable()
+    {
+        // With a null speed the width never changes
+        if (width_speed == 0.0f) {
+            width_table.fill(width_start);
+            return;
+        }
+        for (uint32_t i{0}; i < width_table_size; ++i) {
+            float const t = Smooth::getInterpolationValue(to<float>(i) / to<float>(width_table_size), interpolation);
+            width_table[i] = width_start + (width_end - width_start) * t;
+        }
+        width_table[width_table_size] = width_end;
+    }
+
+    /// Evaluates the width of a point born at @p birth_time
+    [[nodiscard]]
+    float getWidth(float birth_time, float now) const
+    {
+        float const age = (now - birth_time) * width_speed * to<float>(width_table_size);
+        auto const  idx = to<uint32_t>(std::min(std::max(age, 0.0f), to<float>(width_table_size)));
+        return (birth_time == not_drawn) ? 0.0f : width_table[idx];
+    }
+
+    void push(Vec2 pt, float birth_time)
+    {
+        uint64_t const slot = getSlot(points_count);
+        // A point about to be overwritten before settling has to be painted now, with the segment that follows it
+        if (canvas && points_count >= capacity && first_animated <= points_count - capacity) {
+            paintSegment(points_count - capacity + 1, pez::core::getTime());
+        }
+        points[slot] = pt;
+        birth[slot]  = birth_time;
+        ++points_count;
+
+        // Evicted points cannot be updated anymore
+        first_animated = std::max(first_animated, points_count - getSize());
+    }
+
+    [[nodiscard]]
+    bool isAnimated(uint64_t i, float now) const
+    {
+        float const b = birth[getSlot(i)];
+        return b != not_drawn && width_speed != 0.0f && (now - b) * width_speed < 1.0f;
+    }
+
+    /// Points whose width stopped changing are painted on the canvas or added to the levels
+    void advanceSettled(float now)
+    {
+        while (first_animated < points_count && !isAnimated(first_animated, now)) {
+            if (canvas) {
+                paintSegment(first_animated, now);
+            } else {
+                addToLevels(first_animated, now);
+            }
+            ++first_animated;
+        }
+    }
+
+    /// Returns the coarsest level that can be drawn at @p zoom, or nullptr if the full resolution is needed
+    [[nodiscard]]
+    Level* selectLevel(float zoom)
+    {
+        uint64_t const first_point = points_count - getSize();
+        for (auto it = levels.rbegin(); it != levels.rend(); ++it) {
+            uint64_t const first_entry = it->getFirstDrawn(first_point);
+            // A single entry has no segment to draw
+            if (it->count < first_entry + 2) {
+                continue;
+            }
+            if (it->getMaxError(first_entry) * zoom <= decimation_tolerance) {
+                return &(*it);
+            }
+        }
+        return nullptr;
+    }
+
+    /// Adds the settled point @p i to the levels it belongs to
+    void addToLevels(uint64_t i, float now)
+    {
+        uint64_t const first_point = points_count - getSize();
+        for (Level& level : levels) {
+            // Steps are increasing powers of 2, if i is not a multiple of this one it is not of the next ones
+            if (i % level.step) {
+                break;
+            }
+            uint64_t const j = i / level.step;
+            if (i < level.step || i - level.step < first_point) {
+                level.skip(j);
+                continue;
+            }
+
+            uint64_t const prev   = i - level.step;
+            Vec2 const     p0     = points[getSlot(prev)];
+            Vec2 const     p1     = points[getSlot(i)];
+            float const    w0     = getWidth(birth[getSlot(prev)], now);
+            float const    w1     = getWidth(birth[getSlot(i)], now);
+            Vec2 const     d      = p1 - p0;
+            float const    length = MathVec2::length(d);
+            Vec2 const     dir    = (length > 0.0f) ? d / length : Vec2{};
+
+            // Distance of the skipped points to the segment, plus the difference of width with the interpolated one
+            float error = 0.0f;
+            for (uint64_t k{1}; k < level.step; ++k) {
+                uint64_t const slot  = getSlot(prev + k);
+                Vec2 const     v     = points[slot] - p0;
+                float const    along = std::min(std::max(MathVec2::dot(v, dir), 0.0f), length);
+                float const    dist  = MathVec2::length(v - along * dir);
+                float const    t     = to<float>(k) / to<float>(level.step);
+                float const    w     = getWidth(birth[slot], now);
+                error = std::max(error, dist + std::abs(w - (w0 + (w1 - w0) * t)));
+            }
+            level.add(j, error);
+        }
+    }
+
+    /// Paints the segment ending at point @p i on the canvas with the current widths
+    void paintSegment(uint64_t i, float now)
+    {
+        if (i == 0 || i - 1 < points_count - getSize()) {
+            return;
+        }
+        uint64_t const prev = getSlot(i - 1);
+        uint64_t const slot = getSlot(i);
+        canvas->addSegment(points[prev], points[slot], getWidth(birth[prev], now), getWidth(birth[slot], now));
     }
 };
@@ -1,11 +1,13 @@
 #pragma once
 #include "engine/engine.hpp"
 #include "engine/common/utils.hpp"
+#include "engine/common/thread_pool/task_graph.hpp"
 
 #include "user/configuration.hpp"
 #include "user/signal.hpp"
 
 #include "user/dft.hpp"
+#include "user/coefficient_stream.hpp"
 #include "user/machine/cart_wheel.hpp"
 #include "user/machine/paint_tank.hpp"
 #include "user/wheel_sum.hpp"
@@ -17,7 +19,11 @@
 #include "user/machine/tube.hpp"
 
 
-struct Renderer : public pez::core::IRenderer
+/** Renders the DFT and its machine, the DFT time and the tracer are advanced in fixed steps by @p update
+ *  while @p render draws the state interpolated between the last two steps.
+ *  The geometry of the wheels and of the tube is computed concurrently by @p frame_graph before being drawn.
+ */
+struct Renderer : public pez::core::IProcessor, public pez::core::IRenderer
 {
     /// Use 1 or 2 DFT to reconstruct the signal
     enum class Mode
@@ -47,9 +53,16 @@ struct Renderer : public pez::core::IRenderer
     float const slow_motion_coef = 0.01f;
     float const time_speed       = 3.0f;
     float       time             = 0.0f;
+    /// Time before the last step, used for interpolation
+    float       time_previous    = 0.0f;
     bool        slow_mo          = false;
 
-    Tracer tracer;
+    Tracer         tracer;
+    uint32_t const max_tracer_capacity = 1 << 16;
+    /// When painting on the canvas, the tracer only needs to hold the animated tail
+    uint32_t const canvas_tracer_capacity = 512;
+    float const    canvas_scale = 2.0f;
+    PaintCanvas    canvas;
 
     float const axe_padding  = 10.0f;
     float const axe_height   = 10.0f;
@@ -69,10 +82,25 @@ struct Renderer : public pez::core::IRenderer
     PaintTank tank;
     Tube      tube;
 
+    /// Tip markers, kept between frames to avoid building their geometry each time
+    sf::CircleShape marker;
+    sf::CircleShape marker_status;
+
     float const help_margin = 20.0f;
     bool        draw_help   = true;
     sf::Text    text;
 
+    /// Coefficients computed in the background, received at the beginning of each update
+    CoefficientStream coefficients_stream;
+    uint32_t const    coefficients_per_step = 64;
+    /// Waits for the requested coefficients instead of streaming them, for reproducible runs
+    bool              synchronous_coefficients = false;
+
+    /// The wheels only depend on the DFT time, the tube also depends on the physic state
+    tp::TaskGraph         frame_graph;
+    float                 render_time  = 0.0f;
+    PhysicSnapshot const* physic_state = nullptr;
+
     Renderer()
         : signal{0}
         , signal_x{0}
@@ -85,6 +113,7 @@ struct Renderer : public pez::core::IRenderer
         , background_outline(conf::sim::world_size, 20.0f, sf::Color::White)
         , slider_x{slider_size, 5.0f, sf::Color::White}
         , slider_y{{slider_size.y, slider_size.x}, 5.0f, sf::Color::White}
+        , canvas{-conf::sim::world_size * 0.5f, conf::sim::world_size, canvas_scale}
     {
         // Signal X
         dft_x.setSignal(signal_x.data);
@@ -100,12 +129,22 @@ struct Renderer : public pez::core::IRenderer
         cycloid_mono.position = {0.0f, 0.0f};
 
         // Tracer
-        tracer.width_start   = 6.0f;
-        tracer.width_end     = 1.5f;
-        tracer.width_speed   = 1.0f;
-        tracer.interpolation = Interpolation::Linear;
+        tracer.setWidth(6.0f, 1.5f, 1.0f, Interpolation::Linear);
         tracer.setColor({231, 111, 81});
 
+        // Tip markers
+        float const marker_radius{tracer.width_start};
+        marker.setRadius(marker_radius);
+        marker.setOrigin(marker_radius, marker_radius);
+        marker.setOutlineThickness(12.0f);
+        marker.setOutlineColor(sf::Color::White);
+
+        float const status_radius = marker_radius + 4.0f;
+        marker_status.setRadius(status_radius);
+        marker_status.setOrigin(status_radius, status_radius);
+        marker_status.setOutlineThickness(2.0f);
+        marker_status.setFillColor({0, 0, 0, 0});
+
         // Axes
         axe_x.setThickness(4.0f);
         axe_y.setThickness(4.0f);
@@ -114,6 +153,7 @@ struct Renderer : public pez::core::IRenderer
         slider_wheel_1.setWheelRadius(9.0f);
 
         // Background
+        background_outline.setThickness(10.0f);
         background_outline.position = -conf::sim::world_size * 0.5f;
         background.position         = -conf::sim::world_size * 0.5f;
 
@@ -123,35 +163,82 @@ struct Renderer : public pez::core::IRenderer
         text.setCharacterSize(20);
         text.setPosition(help_margin, help_margin);
         text.setString("[H] - Toggle help\n"
-                       "[S] - Add coefficient\n"
+                       "[S] - Add the next strongest coefficient\n"
                        "[M] - Switch dual / mono\n"
                        "[R] - Reset time and tracer\n"
                        "[F] - Toggle focus on tip position\n"
                        "[P] - Toggle paint dispenser rendering\n"
                        "[X] - Toggle slow motion\n"
+                       "[U] - Toggle unlimited framerate\n"
+                       "[C] - Toggle paint canvas\n"
+                       "[W] - Save signal\n"
+                       "[O] - Toggle profiler\n"
+                       "[T] - Save trace\n"
+                       "[G] - Save frame graph\n"
                        "\n"
                        "[Mouse Right] - Draw\n"
                        "[Mouse Left]  - Move viewport\n"
                        "[Mouse Wheel] - Zoom");
+
+        createFrameGraph();
+    }
+
+    void stop() override
+    {
+        coefficients_stream.stop();
+    }
+
+    /// Advances the DFT time by one fixed step
+    void update(float) override
+    {
+        applyCoefficients();
+
+        time_previous = time;
+        if (signal.data.empty()) {
+            return;
+        }
+
+        // The solver may be running, changes are applied before its next step
+        auto& physic = pez::core::getProcessor<PhysicSystem>();
+        Vec2 const tip_position = computeTipPosition(time);
+        physic.edit([target = to<pbd::Vec2D>(tip_position)](pbd::Solver& solver) {
+            solver.drag_constraints[0].setTarget(target);
+        });
+        bool const draw = signal.getDraw(time);
+
+        // Keep one period of the signal in the tracer, or only its animated tail when painting on the canvas
+        tracer.setCapacity(tracer.canvas ? canvas_tracer_capacity : getPeriodPointsCount());
+        tracer.addPoint(tip_position, draw);
+
+        tank.active = tube.getSegmentPaintStatus(signal, time, 0);
+        if (draw_tank) {
+            physic.edit([this, t = time](pbd::Solver&) {
+                tube.updateRigidity(signal, t);
+            });
+        }
+
+        time += getTimeStep();
     }
 
     void render(pez::render::Context& context) override
     {
-        auto& solver = pez::core::getProcessor<PhysicSystem>().solver;
+        auto& physic = pez::core::getProcessor<PhysicSystem>();
+        // The time between the last two steps matching the physic state
+        render_time = time_previous + (time - time_previous) * pez::core::getInterpolation();
+        frame_graph.run(pez::core::getSingleton<tp::ThreadPool>());
 
         // DFT inverse
         if (mode == Mode::Dual) {
-            cycloid_x.render(dft_x, time, context);
-            cycloid_y.render(dft_y, time, context);
+            cycloid_x.render(context);
+            cycloid_y.render(context);
         }
 
-        background_outline.setThickness(10.0f);
         background_outline.render(context);
         background.render(context);
 
         // If in mono mode, render wheel sum on top of background
         if (mode == Mode::Mono) {
-            cycloid_mono.render(dft_mono, time, context);
+            cycloid_mono.render(context);
         }
 
         va_signal.resize(signal.data.size());
@@ -169,14 +256,15 @@ struct Renderer : public pez::core::IRenderer
         }
 
         if (draw_tank) {
-            // Render physic
-            tube.render(signal, time, context);
-            // Tube rigidity
-            tube.updateRigidity(signal, time);
+            // Render physic, objects are drawn between the last two completed steps
+            PhysicSnapshot const& state = *physic_state;
+            tube.render(context);
 
             // Render paint tank
-            auto const &pin = solver.segment_pin_constraints[0];
-            tank.position = {to<float>(pin.object_pinned->getWorldPosition(pin.pinned_particle).x), -conf::sim::world_size.y * 0.5f - background_outline.thickness * 0.5f};
+            auto const& pin          = physic.solver.segment_pin_constraints[0];
+            auto const  pinned_id    = pin.object_pinned.getID();
+            auto const  pin_position = state.getWorldPosition(physic.solver.objects[pinned_id], physic.solver.objects.getDataIndex(pinned_id), pin.pinned_particle);
+            tank.position = {to<float>(pin_position.x), -conf::sim::world_size.y * 0.5f - background_outline.thickness * 0.5f};
             tank.render(context);
 
             // Render
@@ -184,39 +272,14 @@ struct Renderer : public pez::core::IRenderer
         }
 
         Vec2 marker_position = {};
-        float const marker_radius{tracer.width_start};
-        sf::CircleShape marker{marker_radius};
-        marker.setOrigin(marker_radius, marker_radius);
-        marker.setOutlineThickness(12.0f);
-        marker.setOutlineColor(sf::Color::White);
         marker.setFillColor({0, 0, 0, 0});
-
-        float const status_radius = marker_radius + 4.0f;
-        sf::CircleShape marker_status{status_radius};
-        marker_status.setOrigin(status_radius, status_radius);
-        marker_status.setOutlineThickness(2.0f);
-        marker_status.setFillColor({0, 0, 0, 0});
         marker_status.setOutlineColor({0, 100, 0});
-
         if (!signal.data.empty()) {
             marker_position = getTipPosition();
-            solver.drag_constraints[0].setTarget(to<pbd::Vec2D>(marker_position));
-            bool const draw = signal.getDraw(time);
-            if (draw) {
+            if (signal.getDraw(render_time)) {
                 marker.setFillColor({231, 111, 81});
                 marker_status.setOutlineColor(sf::Color::Green);
             }
-
-            tracer.addPoint(marker_position, draw);
-            tracer.render(context);
-
-            tank.active = tube.getSegmentPaintStatus(signal, time, 0);
-
-            if (slow_mo) {
-                time += slow_motion_coef * time_speed / (to<float>(signal.data.size()));
-            } else {
-                time += time_speed / (to<float>(signal.data.size()));
-            }
         }
 
         marker.setPosition(marker_position);
@@ -238,6 +301,38 @@ struct Renderer : public pez::core::IRenderer
         }
     }
 
+    /// Computes the geometry that does not depend on the render context, before it is drawn
+    void createFrameGraph()
+    {
+        auto const physic_node = frame_graph.addNode("Physic state", [this]() {
+            if (draw_tank) {
+                physic_state = &pez::core::getProcessor<PhysicSystem>().getRenderState();
+            }
+        });
+        auto const tube_node = frame_graph.addNode("Tube geometry", [this]() {
+            if (draw_tank) {
+                tube.update(signal, render_time, *physic_state);
+            }
+        });
+        frame_graph.addDependency(physic_node, tube_node);
+
+        frame_graph.addNode("Wheels X", [this]() {
+            if (mode == Mode::Dual) {
+                cycloid_x.update(dft_x, render_time);
+            }
+        });
+        frame_graph.addNode("Wheels Y", [this]() {
+            if (mode == Mode::Dual) {
+                cycloid_y.update(dft_y, render_time);
+            }
+        });
+        frame_graph.addNode("Wheels mono", [this]() {
+            if (mode == Mode::Mono) {
+                cycloid_mono.update(dft_mono, render_time);
+            }
+        });
+    }
+
     /// Updates signals for X and Y, only needed in dual mode
     void updateSignals()
     {
@@ -251,6 +346,43 @@ struct Renderer : public pez::core::IRenderer
         }
     }
 
+    /// Replaces the signal with the one stored in @p filename, has to be called before adding coefficients
+    bool loadSignal(std::string const& filename)
+    {
+        cancelCoefficients();
+        if (!signal.loadFromFile(filename)) {
+            return false;
+        }
+        resetTime();
+        return true;
+    }
+
+    /// Switches between keeping one period of the tracer as geometry and painting it on the canvas
+    void toggleCanvas()
+    {
+        if (tracer.canvas) {
+            tracer.setCanvas(nullptr);
+            canvas.clear();
+        } else {
+            tracer.setCanvas(&canvas);
+        }
+    }
+
+    /// Returns the DFT time added at each step
+    [[nodiscard]]
+    float getTimeStep() const
+    {
+        return (slow_mo ? slow_motion_coef * time_speed : time_speed) / to<float>(signal.data.size());
+    }
+
+    /// Returns the number of steps needed to draw the whole signal at the current speed
+    [[nodiscard]]
+    uint32_t getPeriodPointsCount() const
+    {
+        return std::min(to<uint32_t>(Math::ConstantF32::TwoPi / getTimeStep()) + 1, max_tracer_capacity);
+    }
+
+    /// Returns the tip position of the last rendered wheels
     [[nodiscard]]
     Vec2 getTipPosition() const
     {
@@ -260,15 +392,83 @@ struct Renderer : public pez::core::IRenderer
         return cycloid_mono.tip_position;
     }
 
-    void addCoefficient()
+    /// Evaluates the tip position at time @p t
+    [[nodiscard]]
+    Vec2 computeTipPosition(float t) const
     {
         if (mode == Mode::Dual) {
+            return Vec2{WheelSum::computeTipPosition(dft_x, t).x, WheelSum::computeTipPosition(dft_y, t).y};
+        }
+        return WheelSum::computeTipPosition(dft_mono, t);
+    }
+
+    void resetTime()
+    {
+        time          = 0.0f;
+        time_previous = 0.0f;
+        tracer.clear();
+    }
+
+    /** Adds one coefficient to each DFT, the most energetic one not added yet
+     *
+     *  Coefficients used to be added by increasing frequency, as a [n, -n] pair in dual mode. They are now added by
+     *  decreasing norm, one at a time, so that each press adds the coefficient that improves the drawing the most.
+     */
+    void addCoefficient()
+    {
+        requestCoefficients(1);
+    }
+
+    /// Requests @p count more coefficients for each DFT, from the most to the least energetic
+    void requestCoefficients(uint32_t count)
+    {
+        if (coefficients_stream.isOutdated()) {
             updateSignals();
+            dft_x.clear();
+            dft_y.clear();
+            dft_mono.clear();
+        }
+        coefficients_stream.request(count, mode == Mode::Mono, signal_x.data, signal_y.data, signal.data);
+        if (synchronous_coefficients) {
+            waitCoefficients();
         }
+    }
 
-        dft_x.addCoefficientPair();
-        dft_y.addCoefficientPair();
-        dft_mono.addCoefficient();
+    /// Drops the coefficients being computed, to be called when the signal is modified
+    void cancelCoefficients()
+    {
+        coefficients_stream.invalidate();
+    }
+
+    /// Blocks until all the requested coefficients are added
+    void waitCoefficients()
+    {
+        coefficients_stream.wait([this](CoefficientStream::Item const& item) {
+            addCoefficient(item);
+        });
+    }
+
+    /// Adds the coefficients received since the last step, a few at a time so that they appear progressively
+    void applyCoefficients()
+    {
+        coefficients_stream.poll(coefficients_per_step, [this](CoefficientStream::Item const& item) {
+            addCoefficient(item);
+        });
+    }
+
+    void addCoefficient(CoefficientStream::Item const& item)
+    {
+        switch (item.target) {
+            case CoefficientStream::Target::X:
+                dft_x.coefficients.push_back(item.coef);
+                break;
+            case CoefficientStream::Target::Y:
+                dft_y.coefficients.push_back(item.coef);
+                break;
+            case CoefficientStream::Target::Mono:
+                dft_mono.coefficients.push_back(item.coef);
+                break;
+        }
     }
 
     void renderAxes(pez::render::Context& context)
@@ -276,6 +476,7 @@ struct Renderer : public pez::core::IRenderer
         if (mode == Mode::Dual) {
             axe_x.position = cycloid_x.position + Vec2{cycloid_x.tip_position.x - axe_height * 0.5f, cycloid_x.tip_position.y - axe_padding};
             axe_y.position = cycloid_y.position + Vec2{cycloid_y.tip_position.x - axe_padding, cycloid_y.tip_position.y - axe_height * 0.5f};
+            context.beginLayer();
             slider_wheel_1.position = Vec2{axe_x.position.x + axe_height * 0.5f, conf::sim::world_size.y * 0.5f + background_outline.thickness + slider_wheel_1.wheel_radius};
             slider_wheel_1.render(-(axe_x.position.x), context);
             slider_wheel_1.position = Vec2{axe_x.position.x + axe_height * 0.5f, conf::sim::world_size.y * 0.5f - slider_wheel_1.wheel_radius};
@@ -284,6 +485,7 @@ struct Renderer : public pez::core::IRenderer
             slider_wheel_1.render(axe_y.position.y, context);
             slider_wheel_1.position = Vec2{conf::sim::world_size.x * 0.5f - slider_wheel_1.wheel_radius, axe_y.position.y + axe_height * 0.5f};
             slider_wheel_1.render(-(axe_y.position.y), context);
+            context.endLayer();
             axe_x.render(context);
             axe_y.render(context);
             slider_x.position = Vec2{axe_x.position.x + axe_height * 0.5f, conf::sim::world_size.y * 0.5f + background_outline.thickness * 0.5f} - slider_size * 0.5f;
@@ -94,20 +94,39 @@ struct Signal
     void writeToFile(std::string const& filename) const
     {
         BinaryWriter writer(filename);
-        writer.write(data.size());
+        writer.write(to<uint64_t>(data.size()));
         for (auto const& p : data) {
             writer.write(p);
         }
+        writer.write(points_count);
+        for (uint32_t const f : flags) {
+            writer.write(f);
+        }
     }
 
-    void loadFromFile(std::string const& filename)
+    /// Returns false if the file could not be read
+    bool loadFromFile(std::string const& filename)
     {
         BinaryReader reader(filename);
+        if (!reader.isValid()) {
+            return false;
+        }
         auto const count = reader.read<uint64_t>();
         data.resize(count);
         for (uint64_t i{0}; i < count; ++i) {
             reader.readInto(data[i]);
         }
+        // Older files only contain the points, they are considered all drawn
+        points_count = reader.read<uint32_t>();
+        flags.assign(count, 1);
+        if (points_count == 0) {
+            points_count = to<uint32_t>(count);
+            return true;
+        }
+        for (uint64_t i{0}; i < count; ++i) {
+            reader.readInto(flags[i]);
+        }
+        return true;
     }
 
     [[nodiscard]]
@@ -5,7 +5,7 @@
 /**
  * 2D representation of one DFT coefficient
  */
-struct Wheel : public sf::Drawable
+struct Wheel
 {
     uint32_t const points_count  = 64;
     float const    outline       = 0.05f;
@@ -16,12 +16,12 @@ struct Wheel : public sf::Drawable
     sf::CircleShape pin;
 
     sf::Font& font;
-    mutable sf::Text text;
+    sf::Text  text;
 
     float div = 1.0f;
     DFT::Coef coef;
 
-    mutable sf::Color text_color;
+    sf::Color text_color;
 
     Wheel()
         : cycle{cycle_radius}
@@ -52,13 +52,13 @@ struct Wheel : public sf::Drawable
 
     /** Renders the wheel
      *
-     * @param target The SFML target to render to
-     * @param states The SFML states to apply (transform used here)
+     * @param context The render context to draw with
+     * @param transform The world transform of the wheel
      */
-    void draw(sf::RenderTarget& target, sf::RenderStates states) const override
+    void render(pez::render::Context& context, sf::Transform const& transform)
     {
-        target.draw(cycle, states);
-        target.draw(pin, states);
+        context.draw(cycle, transform);
+        context.draw(pin, transform);
 
         float const norm = coef.getNorm() * div;
         if (norm < 1.0f) {
@@ -68,17 +68,17 @@ struct Wheel : public sf::Drawable
         text.setFillColor({140, 140, 140});
 
         float const space = 0.1f;
-        float end_a = drawText(0.0f, 1.4f, cycle_radius, toString(coef.i), target, states.transform);
-        drawText(end_a + space, 0.3f, cycle_radius - 0.04f, "amplitude", target, states.transform);
-        end_a = drawText(end_a + space, 0.75f, cycle_radius - 0.07f, toString(norm), target, states.transform);
-        drawText(end_a + space, 0.3f, cycle_radius - 0.04f, "phase", target, states.transform);
-        drawText(end_a + space, 0.75f, cycle_radius - 0.07f, toString(coef.getArg()), target, states.transform);
+        float end_a = drawText(0.0f, 1.4f, cycle_radius, pez::core::toFrameString(coef.i), context, transform);
+        drawText(end_a + space, 0.3f, cycle_radius - 0.04f, "amplitude", context, transform);
+        end_a = drawText(end_a + space, 0.75f, cycle_radius - 0.07f, pez::core::toFrameString(norm), context, transform);
+        drawText(end_a + space, 0.3f, cycle_radius - 0.04f, "phase", context, transform);
+        drawText(end_a + space, 0.75f, cycle_radius - 0.07f, pez::core::toFrameString(coef.getArg()), context, transform);
 
         text.setFillColor({200, 200, 200});
-        drawText(0.0f, 0.25f, cycle_radius - 0.8f, (coef.i > 0) ? "rotates this way >>>" : "<<< rotates this way", target, states.transform);
-        drawText(Math::ConstantF32::Pi, 0.25f, cycle_radius - 0.8f, "Mind your fingers", target, states.transform);
+        drawText(0.0f, 0.25f, cycle_radius - 0.8f, (coef.i > 0) ? "rotates this way >>>" : "<<< rotates this way", context, transform);
+        drawText(Math::ConstantF32::Pi, 0.25f, cycle_radius - 0.8f, "Mind your fingers", context, transform);
 
-        drawText(Math::ConstantF32::Pi, 0.5f, cycle_radius, "WARNING: sensitive electronic device // pezzza Inc. 2024", target, states.transform);
+        drawText(Math::ConstantF32::Pi, 0.5f, cycle_radius, "WARNING: sensitive electronic device // pezzza Inc. 2024", context, transform);
     }
 
     /** Renders curved text, following an arc
@@ -87,14 +87,14 @@ struct Wheel : public sf::Drawable
      * @param scale The scale
      * @param radius The radius of the arc
      * @param str The string to render
-     * @param target SFML to target to draw on
+     * @param context The render context to draw with
      * @param transform 2D transformation to apply
      * @return The angle at which the text ends, useful to draw another text after this one
      */
-    float drawText(float start_angle, float scale, float radius, std::string const& str, sf::RenderTarget& target, sf::Transform const& transform) const
+    float drawText(float start_angle, float scale, float radius, std::string_view str, pez::render::Context& context, sf::Transform const& transform)
     {
         /* !! VERY UNOPTIMIZED !!
-         * requires a draw call per char
+         * requires a draw per char, only merged in a few draw calls when the context is batching
          */
 
         // Magic value that could be removed
@@ -102,12 +102,12 @@ struct Wheel : public sf::Drawable
         float const s          = base_scale * scale;
         float a = start_angle - Math::ConstantF32::Pi * 0.5f;
         for (char c : str) {
-            float const advance = font.getGlyph(c, 120, false).advance * s * 1.1f;
+            float const advance = context.getGlyphAdvance(font, c, 120) * s * 1.1f;
             text.setString(c);
             text.setPosition(radius * Vec2{cos(a), sin(a)});
             text.setRotation(Math::radToDeg(a) + 90.0f);
             text.setScale(s, s);
-            target.draw(text, transform);
+            context.draw(text, transform);
             a += advance / radius;
         }
         return a + Math::ConstantF32::Pi * 0.5f;
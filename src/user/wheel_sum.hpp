@@ -1,6 +1,7 @@
 #pragma once
 #include <SFML/Graphics.hpp>
 #include "engine/engine.hpp"
+#include "engine/common/thread_pool/algorithms.hpp"
 
 #include "./dft.hpp"
 #include "./render_common/tracer.hpp"
@@ -13,11 +14,21 @@ struct WheelSum
     sf::Text text;
 
     sf::VertexArray shadow;
+    sf::FloatRect   shadow_bounds;
 
     Vec2   tip_position;
 
     Vec2 position = {};
 
+    /// Wheels computed by @p update, from the largest to the smallest
+    std::vector<DFT::Coef>     sorted_coef;
+    std::vector<sf::Transform> transforms;
+    float                      div = 1.0f;
+    std::vector<DFT::Coef>     sort_buffer;
+
+    /// Draws each coefficient in turn, kept to avoid building its shapes at each frame
+    Wheel wheel;
+
     WheelSum()
     {
         // Font
@@ -35,55 +46,110 @@ struct WheelSum
      */
     void render(DFT const& dft, float t, pez::render::Context& context)
     {
-        // Ensure the signal has been set
+        update(dft, t);
+        render(context);
+    }
+
+    /** Computes the wheels of the inverse of the provided @p DFT at time @p t, without drawing them
+     *
+     *  Does not use the render context so it can run on any thread.
+     *
+     * @param dft The DFT to evaluate
+     * @param t The current time
+     */
+    void update(DFT const& dft, float t)
+    {
+        PEZ_PROFILE_SCOPE("WheelSum::update");
+        sorted_coef.clear();
+        transforms.clear();
+        // Nothing to draw until the signal has been set, this runs on a worker so it is not reported
         if (dft.signal == nullptr) {
-            std::cout << "Uninitialized DFT provided, skipping wheel rendering." << std::endl;
             return;
         }
 
         size_t const samples_count = dft.signal->size();
-        float const  div = 1.0f / to<float>(samples_count);
-
-        // The coefficient representation
-        Wheel wheel;
-        wheel.div = div;
-
-        DFT::Complex current{};
-        std::vector<DFT::Coef> const sorted_coef = getSortedCoefficients(dft);
-
-        for (auto const& c : sorted_coef) {
-            wheel.coef = c;
+        div = 1.0f / to<float>(samples_count);
+
+        auto& thread_pool = pez::core::getSingleton<tp::ThreadPool>();
+        sorted_coef = dft.coefficients;
+        sortCoefficients(thread_pool, sorted_coef, sort_buffer);
+
+        // The epicycles chain is a prefix sum of the rotating coefficients
+        // Position of the end of each wheel, the center of the next one, only needed during the update
+        auto const wheels_count = to<uint32_t>(sorted_coef.size());
+        pez::core::FrameVector<DFT::Complex> wheel_ends(wheels_count);
+        tp::inclusiveScan(thread_pool, wheels_count, DFT::Complex{},
+            [&](uint32_t i) {
+                DFT::Coef const& c = sorted_coef[i];
+                float const x = t * to<float>(c.i);
+                return c.v * div * DFT::Complex{cos(x), sin(x)};
+            },
+            std::plus<DFT::Complex>{}, wheel_ends.data());
+
+        transforms.resize(wheels_count);
+        thread_pool.parallelFor(0, wheels_count, tp::min_block_size, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i{begin}; i < end; ++i) {
+                DFT::Coef const&   c       = sorted_coef[i];
+                DFT::Complex const center  = i ? wheel_ends[i - 1] : DFT::Complex{};
+                float const        radius{c.getNorm() * div};
+
+                sf::Transform& transform = transforms[i];
+                transform = sf::Transform::Identity;
+                transform.translate(center.real() + position.x, center.imag() + position.y);
+                transform.scale(radius, radius);
+                transform.rotate(Math::radToDeg(c.getArg() + to<float>(c.i) * t));
+            }
+        });
 
-            float const radius{c.getNorm() * div};
+        DFT::Complex const tip = wheels_count ? wheel_ends.back() : DFT::Complex{};
+        tip_position = {tip.real(), tip.imag()};
+    }
 
-            sf::Transform transform;
-            transform.translate(current.real() + position.x, current.imag() + position.y);
-            transform.scale(radius, radius);
-            transform.rotate(Math::radToDeg(c.getArg() + to<float>(c.i) * t));
-            context.draw(shadow, transform);
-            context.draw(wheel, transform);
+    /// Draws the wheels computed by the last call to @p update
+    void render(pez::render::Context& context)
+    {
+        PEZ_PROFILE_SCOPE("WheelSum::render");
+        pez::render::Context::StatsTag const stats_tag{context, "WheelSum"};
 
-            float const x = t * to<float>(c.i);
-            current += c.v * div * DFT::Complex{cos(x), sin(x)};
+        wheel.div = div;
+        for (size_t i{0}; i < transforms.size(); ++i) {
+            wheel.coef = sorted_coef[i];
+            // Wheels are unit circles scaled by their radius, the shadow being the widest part
+            if (context.drawCulled(shadow, shadow_bounds, transforms[i])) {
+                wheel.render(context, transforms[i]);
+            }
         }
-
-        tip_position = {current.real(), current.imag()};
     }
 
-    /** Sorts the coefficients of the provided DFT by descending norm
+    /** Computes the position of the tip at time @p t without rendering
      *
-     * @param dft The DFT to operate on
-     * @return A copy of the coefficients, sorted by descending norm
+     * @param dft The DFT to evaluate
+     * @param t The time
+     * @return The tip position, relative to @p position like @p tip_position
      */
     [[nodiscard]]
-    static std::vector<DFT::Coef> getSortedCoefficients(DFT const& dft)
+    static Vec2 computeTipPosition(DFT const& dft, float t)
     {
-        std::vector<DFT::Coef> result = dft.coefficients;
-        // Sort coefficients by descending norm
-        std::sort(result.begin(), result.end(), [](DFT::Coef const& c1, DFT::Coef const& c2) {
+        if (dft.signal == nullptr || dft.signal->empty()) {
+            return {};
+        }
+        float const        div     = 1.0f / to<float>(dft.signal->size());
+        auto const&        coefs   = dft.coefficients;
+        DFT::Complex const current = tp::reduce(pez::core::getSingleton<tp::ThreadPool>(), to<uint32_t>(coefs.size()), DFT::Complex{},
+            [&](uint32_t i) {
+                float const x = t * to<float>(coefs[i].i);
+                return coefs[i].v * div * DFT::Complex{cos(x), sin(x)};
+            },
+            std::plus<DFT::Complex>{});
+        return {current.real(), current.imag()};
+    }
+
+    /// Sorts @p coefs by descending norm, in parallel for large DFTs
+    static void sortCoefficients(tp::ThreadPool& thread_pool, std::vector<DFT::Coef>& coefs, std::vector<DFT::Coef>& buffer)
+    {
+        tp::sort(thread_pool, coefs, [](DFT::Coef const& c1, DFT::Coef const& c2) {
             return c1.getNorm() > c2.getNorm();
-        });
-        return result;
+        }, buffer);
     }
 
     /// Generates the wheel's shadow
@@ -104,5 +170,6 @@ struct WheelSum
             shadow[i + 1].position = (1.0f + shadow_thickness) * Vec2{cos(a), sin(a)};
             shadow[i + 1].color    = sf::Color{20, 20, 20, 0};
         }
+        shadow_bounds = shadow.getBounds();
     }
 };
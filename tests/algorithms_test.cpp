@@ -0,0 +1,133 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "engine/common/thread_pool/algorithms.hpp"
+
+
+/** Checks that tp::reduce, tp::inclusiveScan and tp::sort give bitwise identical results whatever the number of
+ *  workers, on inputs spanning several blocks. Floating point sums are used since they depend on the combination order.
+ *  The algorithms are also called from a thread that did not create the pool, which has no deque to split loops on.
+ */
+namespace
+{
+
+struct Key
+{
+    float    value;
+    /// Position in the input, to check that equal values are ordered the same way
+    uint32_t index;
+};
+
+struct Results
+{
+    float              sum = 0.0f;
+    std::vector<float> scan;
+    std::vector<Key>   sorted;
+};
+
+Results compute(tp::ThreadPool& pool, std::vector<float> const& values, std::vector<Key> const& keys)
+{
+    auto const count = static_cast<uint32_t>(values.size());
+
+    Results results;
+    results.sum = tp::reduce(pool, count, 0.0f, [&](uint32_t i) { return values[i]; }, std::plus<float>{});
+
+    results.scan.resize(count);
+    tp::inclusiveScan(pool, count, 0.0f, [&](uint32_t i) { return values[i]; }, std::plus<float>{}, results.scan.data());
+
+    results.sorted = keys;
+    std::vector<Key> buffer;
+    tp::sort(pool, results.sorted, [](Key const& k1, Key const& k2) { return k1.value < k2.value; }, buffer);
+    return results;
+}
+
+Results run(uint32_t worker_count, bool from_creator, std::vector<float> const& values, std::vector<Key> const& keys)
+{
+    tp::ThreadPool pool{worker_count};
+    if (from_creator) {
+        return compute(pool, values, keys);
+    }
+    Results results;
+    std::thread thread{[&]() {
+        results = compute(pool, values, keys);
+    }};
+    thread.join();
+    return results;
+}
+
+template<typename T>
+bool isSame(std::vector<T> const& v1, std::vector<T> const& v2)
+{
+    return v1.size() == v2.size() && std::memcmp(v1.data(), v2.data(), v1.size() * sizeof(T)) == 0;
+}
+
+bool check(uint32_t count)
+{
+    std::mt19937 rng{count};
+    // Wide range of magnitudes so that the sums are sensitive to the order
+    std::uniform_real_distribution<float> exponent{-8.0f, 8.0f};
+    std::uniform_int_distribution<int32_t> sign{0, 1};
+    // Few distinct keys to get many ties
+    std::uniform_int_distribution<int32_t> key{0, 15};
+
+    std::vector<float> values(count);
+    std::vector<Key>   keys(count);
+    for (uint32_t i{0}; i < count; ++i) {
+        values[i] = (sign(rng) ? 1.0f : -1.0f) * std::exp2(exponent(rng));
+        keys[i]   = {static_cast<float>(key(rng)), i};
+    }
+
+    struct Config
+    {
+        uint32_t worker_count;
+        bool     from_creator;
+    };
+
+    Results const reference = run(0, true, values, keys);
+    bool success = true;
+    for (Config const config : {Config{1, true}, Config{4, true}, Config{0, false}, Config{4, false}}) {
+        Results const results = run(config.worker_count, config.from_creator, values, keys);
+        auto const report = [&](char const* what) {
+            std::cerr << what << " differs with " << config.worker_count << " workers"
+                      << (config.from_creator ? "" : " from another thread") << " on " << count << " elements" << std::endl;
+            success = false;
+        };
+        if (std::memcmp(&results.sum, &reference.sum, sizeof(float)) != 0) {
+            report("reduce");
+        }
+        if (!isSame(results.scan, reference.scan)) {
+            report("inclusiveScan");
+        }
+        if (!isSame(results.sorted, reference.sorted)) {
+            report("sort");
+        }
+    }
+
+    bool const ordered = std::is_sorted(reference.sorted.begin(), reference.sorted.end(), [](Key const& k1, Key const& k2) {
+        return k1.value < k2.value;
+    });
+    if (!ordered) {
+        std::cerr << "sort output is not ordered on " << count << " elements" << std::endl;
+        success = false;
+    }
+    return success;
+}
+
+}
+
+int main()
+{
+    bool success = true;
+    // Just above two blocks, a partial last block, and the maximum number of blocks
+    for (uint32_t count : {2 * tp::min_block_size + 1, 5 * tp::min_block_size + 17, 200000u}) {
+        success = check(count) && success;
+    }
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
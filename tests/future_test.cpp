@@ -0,0 +1,125 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "engine/common/thread_pool/thread_pool.hpp"
+
+
+/** Checks the jobs submitted to the thread pool: results are returned by their Future, cancelled jobs see it through
+ *  their token and return nothing, and jobs returning void report their completion.
+ */
+namespace
+{
+
+bool success = true;
+
+void expect(bool condition, char const* what)
+{
+    if (!condition) {
+        std::cerr << "Failed: " << what << std::endl;
+        success = false;
+    }
+}
+
+/// Polls @p future like the frame loop does, gives up after a few seconds
+template<typename TFuture>
+bool pollUntilReady(TFuture const& future)
+{
+    auto const deadline = std::chrono::steady_clock::now() + std::chrono::seconds{5};
+    while (!future.isReady()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+    return true;
+}
+
+void checkResult(tp::ThreadPool& pool)
+{
+    // Captures larger than an InlineTask
+    std::string const text(256, 'a');
+    auto future = pool.submit([text](tp::CancellationToken const&) {
+        return static_cast<uint32_t>(text.size());
+    });
+    expect(future.isValid(), "a submitted job has a valid future");
+    expect(pollUntilReady(future), "isReady becomes true once the job is done");
+    std::optional<uint32_t> const result = future.take();
+    expect(result.has_value() && *result == 256, "take returns the result");
+    expect(!future.isValid(), "the future is invalid after take");
+    expect(!future.take().has_value(), "take on an invalid future returns nothing");
+}
+
+void checkCancel(tp::ThreadPool& pool)
+{
+    std::atomic<bool> started   = false;
+    std::atomic<bool> cancelled = false;
+    auto future = pool.submit([&](tp::CancellationToken const& token) {
+        started = true;
+        // Cooperative cancellation, the job checks its token regularly
+        while (!token.isCancelled()) {
+            std::this_thread::yield();
+        }
+        cancelled = true;
+        return 1;
+    });
+    while (!started) {
+        std::this_thread::yield();
+    }
+    expect(!future.isReady(), "a running job is not ready");
+    future.cancel();
+    expect(!future.take().has_value(), "take returns nothing after cancel");
+    expect(cancelled, "the job sees the cancellation through its token");
+}
+
+void checkVoid(tp::ThreadPool& pool)
+{
+    std::atomic<bool> executed = false;
+    auto future = pool.submit([&](tp::CancellationToken const&) {
+        executed = true;
+    });
+    expect(future.take().has_value(), "take reports the completion of a job returning void");
+    expect(executed, "a job returning void is executed");
+
+    auto cancelled = pool.submit([](tp::CancellationToken const& token) {
+        while (!token.isCancelled()) {
+            std::this_thread::yield();
+        }
+    });
+    cancelled.cancel();
+    expect(!cancelled.take().has_value(), "take returns nothing for a cancelled job returning void");
+}
+
+void checkNotWaited(tp::ThreadPool& pool)
+{
+    std::atomic<bool> release = false;
+    auto future = pool.submit([&](tp::CancellationToken const&) {
+        while (!release) {
+            std::this_thread::yield();
+        }
+        return true;
+    });
+    // Would never return if the job was counted
+    pool.waitForCompletion();
+    expect(!future.isReady(), "waitForCompletion does not wait for the submitted jobs");
+    release = true;
+    expect(future.take().value_or(false), "the job completes once released");
+}
+
+}
+
+int main()
+{
+    // Submitted jobs are executed by the workers, at least one is needed
+    for (uint32_t worker_count : {1u, 3u}) {
+        tp::ThreadPool pool{worker_count};
+        checkResult(pool);
+        checkCancel(pool);
+        checkVoid(pool);
+        checkNotWaited(pool);
+    }
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}